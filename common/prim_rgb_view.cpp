@@ -102,6 +102,7 @@ static rend::ActiveAttrSemantics g_active_attr_semantics[PROG_COUNT];
 
 static GLsizei g_tex_w;
 static GLsizei g_tex_h;
+static GLenum g_pixmap_format;
 
 bool
 deinit_resources()
@@ -144,11 +145,22 @@ bool
 init_resources(
 	const size_t w,
 	const size_t h)
+{
+	return init_resources(w, h, PIXEL_FORMAT_RGBA8);
+}
+
+
+bool
+init_resources(
+	const size_t w,
+	const size_t h,
+	const PixelFormat format)
 {
 	scoped_ptr< deinit_resources_t, scoped_functor > on_error(deinit_resources);
 
 	g_tex_w = w;
 	g_tex_h = h;
+	g_pixmap_format = PIXEL_FORMAT_IA8 == format ? GL_RG_INTEGER : GL_RGBA_INTEGER;
 
 	glGenTextures(sizeof(g_tex) / sizeof(g_tex[0]), g_tex);
 
@@ -167,7 +179,18 @@ init_resources(
 	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
-	glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGBA8UI, g_tex_w, g_tex_h, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 0);
+	if (PIXEL_FORMAT_IA8 == format)
+	{
+		// spread the intensity over R, G and B by swizzle, so that the shaders sample both formats alike; rows of
+		// intensity-alpha pixmaps are aligned to their pixels only
+		const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+
+		glTexParameteriv(GL_TEXTURE_RECTANGLE, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RG8UI, g_tex_w, g_tex_h, 0, GL_RG_INTEGER, GL_UNSIGNED_BYTE, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	}
+	else
+		glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGBA8UI, g_tex_w, g_tex_h, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 0);
 
 	glBindTexture(GL_TEXTURE_RECTANGLE, 0);
 
@@ -436,7 +459,7 @@ render(
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_RECTANGLE, g_tex[TEX_BILLBOARD]);
 
-		glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, 0, 0, g_tex_w, g_tex_h, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, pixmap);
+		glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, 0, 0, g_tex_w, g_tex_h, g_pixmap_format, GL_UNSIGNED_BYTE, pixmap);
 
 		glUniform1i(g_uni[prog][UNI_SAMPLER_BILLBOARD], 0);
 	}
@@ -515,7 +538,7 @@ render(
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_RECTANGLE, g_tex[TEX_BILLBOARD]);
 
-		glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, 0, 0, g_tex_w, g_tex_h, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, pixmap);
+		glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, 0, 0, g_tex_w, g_tex_h, g_pixmap_format, GL_UNSIGNED_BYTE, pixmap);
 
 		glUniform1i(g_uni[prog][UNI_SAMPLER_BILLBOARD], 0);
 	}
@@ -7,6 +7,13 @@ namespace testbed
 namespace rgbv
 {
 
+// formats of the pixmaps to render
+enum PixelFormat
+{
+	PIXEL_FORMAT_RGBA8, // R, G, B and A bytes
+	PIXEL_FORMAT_IA8    // intensity and A bytes, the intensity standing for each of R, G and B
+};
+
 bool
 deinit_resources();
 
@@ -15,6 +22,12 @@ init_resources(
 	const size_t w,
 	const size_t h);
 
+bool
+init_resources(
+	const size_t w,
+	const size_t h,
+	const PixelFormat format);
+
 bool
 render(
 	const void* pixmap);
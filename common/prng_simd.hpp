@@ -0,0 +1,83 @@
+#ifndef prng_simd_H__
+#define prng_simd_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+// Vectorized xorshift128+ -- two independent generators of two 64-bit lanes each, yielding eight 32-bit randoms per
+// step without a serial dependency between the two generators. Functions have internal linkage, so that translation
+// units built for different ISA levels each keep their own copies.
+
+namespace prng {
+
+struct State
+{
+	__m128i s[4]; // s0 and s1 of the first generator, followed by those of the second
+};
+
+// splitmix64 step, used to expand a seed into a non-zero xorshift state
+static inline uint64_t
+splitmix64(
+	uint64_t& x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ z >> 27) * 0x94d049bb133111ebULL;
+	return z ^ z >> 31;
+}
+
+static inline void
+seed(
+	State& state,
+	const uint64_t seed)
+{
+	uint64_t x = seed;
+
+	for (size_t i = 0; i < sizeof(state.s) / sizeof(state.s[0]); ++i)
+	{
+		const uint64_t lo = splitmix64(x);
+		const uint64_t hi = splitmix64(x);
+		state.s[i] = _mm_set_epi64x(int64_t(hi), int64_t(lo));
+	}
+}
+
+// advance a single two-lane generator
+static inline __m128i __attribute__ ((always_inline))
+step(
+	__m128i& s0,
+	__m128i& s1)
+{
+	__m128i a = s0;
+	const __m128i b = s1;
+
+	s0 = b;
+	a = _mm_xor_si128(a, _mm_slli_epi64(a, 23));
+	s1 = _mm_xor_si128(_mm_xor_si128(a, b), _mm_xor_si128(_mm_srli_epi64(a, 17), _mm_srli_epi64(b, 26)));
+
+	return _mm_add_epi64(s1, b);
+}
+
+// produce eight uniformly distributed 32-bit randoms
+static inline void __attribute__ ((always_inline))
+next(
+	State& state,
+	__m128i& r0,
+	__m128i& r1)
+{
+	r0 = step(state.s[0], state.s[1]);
+	r1 = step(state.s[2], state.s[3]);
+}
+
+// map 32-bit randoms to floats in [0, 1), by the top 24 bits of each lane; of the 64-bit xorshift128+ outputs, those are
+// bits 8-31 in even lanes and bits 40-63 in odd lanes, either way clear of the weakest lowest bits
+static inline __m128 __attribute__ ((always_inline))
+unit(
+	const __m128i r)
+{
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(r, 8)), _mm_set1_ps(1.f / (1 << 24)));
+}
+
+} // namespace prng
+
+#endif // prng_simd_H__
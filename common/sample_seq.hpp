@@ -0,0 +1,206 @@
+#ifndef sample_seq_H__
+#define sample_seq_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Low-discrepancy 2D sample sequences and a tiled blue-noise mask for decorrelating them across pixels (Cranley-Patterson
+// rotation). Samples are 32-bit fixed-point fractions in [0, 1), so a rotation is a wrapping add. Kept free of any
+// host-only facility -- the OpenCL kernels carry a verbatim copy of the sequences (see prob_7/kernel/prologue.cl).
+
+#define SAMPLE_SEQ_BLUE_NOISE_LOG2 5
+
+namespace sampling {
+
+enum Strategy
+{
+	strategy_random, // independent uniform randoms
+	strategy_r2,     // R2 sequence, from the plastic constant
+	strategy_sobol,  // first two dimensions of the Sobol sequence
+
+	strategy_count
+};
+
+enum
+{
+	blue_noise_log2 = SAMPLE_SEQ_BLUE_NOISE_LOG2,
+	blue_noise_size = 1 << blue_noise_log2,
+	blue_noise_cells = blue_noise_size * blue_noise_size
+};
+
+// sample n of the R2 sequence: frac(.5 + n / g, .5 + n / g^2), g being the plastic constant
+static inline void
+r2(
+	const uint32_t n,
+	uint32_t (& u)[2])
+{
+	u[0] = 0x80000000U + n * 3242174889U;
+	u[1] = 0x80000000U + n * 2447445414U;
+}
+
+// sample n of the Sobol sequence: van der Corput in base 2, and the second Sobol dimension (primitive polynomial x + 1)
+static inline void
+sobol(
+	const uint32_t n,
+	uint32_t (& u)[2])
+{
+	uint32_t u0 = 0;
+	uint32_t u1 = 0;
+	uint32_t v0 = 1U << 31;
+	uint32_t v1 = 1U << 31;
+
+	for (uint32_t i = n; 0 != i; i >>= 1) {
+		if (i & 1) {
+			u0 ^= v0;
+			u1 ^= v1;
+		}
+		v0 >>= 1;
+		v1 ^= v1 >> 1;
+	}
+
+	u[0] = u0;
+	u[1] = u1;
+}
+
+// sample n of the sequence of the given strategy; the random strategy has no sequence, so it yields zeros
+static inline void
+sample(
+	const Strategy strategy,
+	const uint32_t n,
+	uint32_t (& u)[2])
+{
+	u[0] = 0;
+	u[1] = 0;
+
+	if (strategy_r2 == strategy)
+		r2(n, u);
+
+	if (strategy_sobol == strategy)
+		sobol(n, u);
+}
+
+// add the gaussian footprint of the given cell, with the given sign, to the energy of a toroidal mask
+static inline void
+splat(
+	float (& energy)[blue_noise_cells],
+	const float (& footprint)[blue_noise_cells],
+	const size_t cell,
+	const float sign)
+{
+	const size_t cx = cell % blue_noise_size;
+	const size_t cy = cell / blue_noise_size;
+
+	for (size_t y = 0; y < blue_noise_size; ++y)
+		for (size_t x = 0; x < blue_noise_size; ++x) {
+			const size_t dx = (x - cx) & blue_noise_size - 1;
+			const size_t dy = (y - cy) & blue_noise_size - 1;
+			energy[y * blue_noise_size + x] += sign * footprint[dy * blue_noise_size + dx];
+		}
+}
+
+// find the occupied cell of the highest energy (tightest cluster), or the vacant cell of the lowest energy (largest void)
+static inline size_t
+find_cell(
+	const float (& energy)[blue_noise_cells],
+	const bool (& occupied)[blue_noise_cells],
+	const bool cluster)
+{
+	size_t best = blue_noise_cells;
+
+	for (size_t i = 0; i < blue_noise_cells; ++i) {
+		if (occupied[i] != cluster)
+			continue;
+
+		if (blue_noise_cells == best || (cluster ? energy[i] > energy[best] : energy[i] < energy[best]))
+			best = i;
+	}
+
+	return best;
+}
+
+// build a tileable blue-noise mask of uniformly distributed 32-bit fractions by the void-and-cluster method; deterministic
+static inline void
+build_blue_noise(
+	uint32_t (& mask)[blue_noise_cells])
+{
+	const float sigma = 1.5f;
+	float footprint[blue_noise_cells];
+
+	for (size_t y = 0; y < blue_noise_size; ++y)
+		for (size_t x = 0; x < blue_noise_size; ++x) {
+			const float dx = float(x < blue_noise_size / 2 ? x : blue_noise_size - x);
+			const float dy = float(y < blue_noise_size / 2 ? y : blue_noise_size - y);
+			footprint[y * blue_noise_size + x] = expf((dx * dx + dy * dy) * (-.5f / (sigma * sigma)));
+		}
+
+	float energy[blue_noise_cells] = { 0.f };
+	bool occupied[blue_noise_cells] = { false };
+
+	// initial binary pattern: a tenth of the cells, each placed in the largest void of the prior ones, then relaxed by
+	// moving the tightest cluster to the largest void until that is a no-op
+	const size_t initial_count = blue_noise_cells / 10;
+
+	for (size_t i = 0; i < initial_count; ++i) {
+		const size_t cell = find_cell(energy, occupied, false);
+		occupied[cell] = true;
+		splat(energy, footprint, cell, 1.f);
+	}
+
+	for (size_t i = 0; i < blue_noise_cells; ++i) {
+		const size_t cluster = find_cell(energy, occupied, true);
+		occupied[cluster] = false;
+		splat(energy, footprint, cluster, -1.f);
+
+		const size_t vacancy = find_cell(energy, occupied, false);
+		occupied[vacancy] = true;
+		splat(energy, footprint, vacancy, 1.f);
+
+		if (cluster == vacancy)
+			break;
+	}
+
+	// rank the initial pattern by removing its tightest clusters, then rank the rest by filling the largest voids
+	float energy_initial[blue_noise_cells];
+	bool occupied_initial[blue_noise_cells];
+	memcpy(energy_initial, energy, sizeof(energy));
+	memcpy(occupied_initial, occupied, sizeof(occupied));
+
+	const size_t shift = 32 - 2 * blue_noise_log2;
+
+	for (size_t rank = initial_count; 0 != rank; --rank) {
+		const size_t cell = find_cell(energy, occupied, true);
+		occupied[cell] = false;
+		splat(energy, footprint, cell, -1.f);
+		mask[cell] = uint32_t(rank - 1) << shift;
+	}
+
+	memcpy(energy, energy_initial, sizeof(energy));
+	memcpy(occupied, occupied_initial, sizeof(occupied));
+
+	for (size_t rank = initial_count; rank < blue_noise_cells; ++rank) {
+		const size_t cell = find_cell(energy, occupied, false);
+		occupied[cell] = true;
+		splat(energy, footprint, cell, 1.f);
+		mask[cell] = uint32_t(rank) << shift;
+	}
+}
+
+// get the pair of rotations of a pixel -- the mask value at the pixel, and that half a tile away diagonally
+static inline void
+rotation(
+	const uint32_t (& mask)[blue_noise_cells],
+	const unsigned x,
+	const unsigned y,
+	uint32_t (& r)[2])
+{
+	const unsigned half = blue_noise_size / 2;
+
+	r[0] = mask[(y & blue_noise_size - 1) * blue_noise_size + (x & blue_noise_size - 1)];
+	r[1] = mask[(y + half & blue_noise_size - 1) * blue_noise_size + (x + half & blue_noise_size - 1)];
+}
+
+} // namespace sampling
+
+#endif // sample_seq_H__
@@ -9,6 +9,8 @@
 #include "scoped.hpp"
 #include "stream.hpp"
 #include "timer.h"
+#include "prng_simd.hpp"
+#include "sample_seq.hpp"
 
 // verify iostream-free status
 #if _GLIBCXX_IOSTREAM
@@ -109,6 +111,165 @@ write_png(
 	return true;
 }
 
+// draw the given number of randoms from rand_r and from the SIMD PRNG, reporting throughput and a chi-square of
+// the top byte of the randoms (255 degrees of freedom; expected 255, with 99% of passes below 310)
+static void
+check_prng(
+	const size_t count)
+{
+	size_t bucket_libc[256] = { 0 };
+	size_t bucket_simd[256] = { 0 };
+
+	unsigned seed = 1;
+	const uint64_t t0 = timer_ns();
+
+	for (size_t i = 0; i < count; ++i)
+		bucket_libc[rand_r(&seed) >> 23 & 0xff] += 1;
+
+	prng::State rng;
+	prng::seed(rng, 1);
+	const uint64_t t1 = timer_ns();
+
+	for (size_t i = 0; i < count; i += 8) {
+		__m128i r0;
+		__m128i r1;
+		prng::next(rng, r0, r1);
+
+		uint32_t r[8] __attribute__ ((aligned(16)));
+		_mm_store_si128(reinterpret_cast< __m128i* >(r + 0), r0);
+		_mm_store_si128(reinterpret_cast< __m128i* >(r + 4), r1);
+
+		for (size_t j = 0; j < 8; ++j)
+			bucket_simd[r[j] >> 24] += 1;
+	}
+
+	const uint64_t t2 = timer_ns();
+
+	double chi2_libc = 0.0;
+	double chi2_simd = 0.0;
+	const double expected = count / 256.0;
+
+	for (size_t i = 0; i < 256; ++i) {
+		chi2_libc += (bucket_libc[i] - expected) * (bucket_libc[i] - expected) / expected;
+		chi2_simd += (bucket_simd[i] - expected) * (bucket_simd[i] - expected) / expected;
+	}
+
+	stream::cout << "rand_r: " << count * 1e3 / (t1 - t0) << " Mrnd/s, chi-square: " << chi2_libc << '\n';
+	stream::cout << "prng::next: " << count * 1e3 / (t2 - t1) << " Mrnd/s, chi-square: " << chi2_simd << '\n';
+}
+
+// 32-bit fixed-point fraction to float in [0, 1)
+static float
+unit(
+	const uint32_t u)
+{
+	return (u >> 8) * (1.f / (1 << 24));
+}
+
+// test integrand over the unit square, mapped to the cosine-weighted hemisphere about the x-axis: visibility past a
+// tilted occluding plane
+static float
+visibility(
+	const float u0,
+	const float u1)
+{
+	const float sin_decl = sqrtf(1.f - u0);
+	const float cos_decl = sqrtf(u0);
+	float sin_azim;
+	float cos_azim;
+	sincosf(u1 * float(M_PI * 2), &sin_azim, &cos_azim);
+
+	const float hemi[] = { cos_decl, cos_azim * sin_decl, sin_azim * sin_decl };
+
+	return hemi[0] * .3f + hemi[1] * .8f + hemi[2] * .5f > .45f ? 0.f : 1.f;
+}
+
+// L2-star discrepancy of a point set in the unit square (Warnock)
+static double
+discrepancy(
+	const float (* const point)[2],
+	const size_t count)
+{
+	double sum0 = 0.0;
+	double sum1 = 0.0;
+
+	for (size_t i = 0; i < count; ++i) {
+		sum0 += (1.0 - point[i][0] * point[i][0]) * (1.0 - point[i][1] * point[i][1]) * .25;
+
+		for (size_t j = 0; j < count; ++j)
+			sum1 += (1.0 - fmax(point[i][0], point[j][0])) * (1.0 - fmax(point[i][1], point[j][1]));
+	}
+
+	return sqrt(1.0 / 9.0 - 2.0 / count * sum0 + sum1 / (double(count) * count));
+}
+
+// compare the sampling strategies per ray count, by mean L2-star discrepancy and RMS error of the visibility estimate,
+// over as many sample sets as there are cells in the blue-noise mask -- each cell rotates the sequences differently
+static void
+check_sequences()
+{
+	const size_t resolution = 2048;
+	double reference = 0.0;
+
+	for (size_t i = 0; i < resolution; ++i)
+		for (size_t j = 0; j < resolution; ++j)
+			reference += visibility((i + .5f) / resolution, (j + .5f) / resolution);
+
+	reference /= resolution * resolution;
+
+	uint32_t mask[sampling::blue_noise_cells];
+	sampling::build_blue_noise(mask);
+
+	const char* const name[] = { "random", "r2", "sobol" };
+	const size_t ray_count[] = { 4, 8, 16, 24, 32, 64 };
+	const size_t max_ray_count = 64;
+
+	stream::cout << "visibility reference: " << reference << '\n';
+
+	for (size_t s = 0; s < sampling::strategy_count; ++s) {
+		prng::State rng;
+		prng::seed(rng, 1);
+
+		for (size_t k = 0; k < sizeof(ray_count) / sizeof(ray_count[0]); ++k) {
+			double sum_discrepancy = 0.0;
+			double sum_error2 = 0.0;
+
+			for (size_t c = 0; c < sampling::blue_noise_cells; ++c) {
+				float point[max_ray_count][2];
+				double estimate = 0.0;
+
+				for (size_t i = 0; i < ray_count[k]; ++i) {
+					uint32_t u[2];
+					sampling::sample(sampling::Strategy(s), i, u);
+
+					if (sampling::strategy_random == s) {
+						__m128i r0;
+						__m128i r1;
+						prng::next(rng, r0, r1);
+						u[0] = _mm_cvtsi128_si32(r0);
+						u[1] = _mm_cvtsi128_si32(r1);
+					}
+
+					uint32_t r[2];
+					sampling::rotation(mask, c % sampling::blue_noise_size, c / sampling::blue_noise_size, r);
+
+					point[i][0] = unit(u[0] + r[0]);
+					point[i][1] = unit(u[1] + r[1]);
+					estimate += visibility(point[i][0], point[i][1]);
+				}
+
+				const double error = estimate / ray_count[k] - reference;
+				sum_error2 += error * error;
+				sum_discrepancy += discrepancy(point, ray_count[k]);
+			}
+
+			stream::cout << name[s] << " rays: " << ray_count[k] <<
+				", discrepancy: " << sum_discrepancy / sampling::blue_noise_cells <<
+				", RMS error: " << sqrt(sum_error2 / sampling::blue_noise_cells) << '\n';
+		}
+	}
+}
+
 int main(int argc, char** argv)
 {
 	using testbed::scoped_ptr;
@@ -121,6 +282,9 @@ int main(int argc, char** argv)
 	stream::cout.open(stdout);
 	stream::cerr.open(stderr);
 
+	check_prng(1 << 26);
+	check_sequences();
+
 	const uint32_t image_w = 800;
 	const uint32_t image_h = 800;
 
@@ -137,14 +301,39 @@ int main(int argc, char** argv)
 	const uint32_t ao_probe_count = 1 << 10;
 
 	srand(1);
+
+#if PRNG_SIMD != 0
+	prng::State rng;
+	prng::seed(rng, rand());
+	uint32_t rnd[8] __attribute__ ((aligned(16)));
+
+#else
 	unsigned seed0 = rand();
 	unsigned seed1 = rand();
 
+#endif
 	for (size_t i = 0; i < ao_probe_count; ++i) {
 		const compile_assert< 0 == (RAND_MAX & RAND_MAX + 1LL) > assert_rand_pot;
+
+#if PRNG_SIMD != 0
+		// refill every four probes; shift to the range of rand_r
+		if (0 == i % 4) {
+			__m128i r0;
+			__m128i r1;
+			prng::next(rng, r0, r1);
+			_mm_store_si128(reinterpret_cast< __m128i* >(rnd + 0), r0);
+			_mm_store_si128(reinterpret_cast< __m128i* >(rnd + 4), r1);
+		}
+
+		const int r0 = int(rnd[i % 4 + 0] >> 1);
+		const int r1 = int(rnd[i % 4 + 4] >> 1);
+
+#else
 		const int r0 = rand_r(&seed0);
 		const int r1 = rand_r(&seed1);
 
+#endif
+
 #if ALT == 0
 		const float r[] = {
 			r0 * float(M_PI_2   / (RAND_MAX + 1LL)), // decl0
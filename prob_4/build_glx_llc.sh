@@ -58,6 +58,10 @@ CFLAGS=(
 #	-DOUTDATED_MESA=1
 # Draw octree cells instead of octree content
 #	-DDRAW_TREE_CELLS=1
+# Accumulate AO in float over the frames of an unchanged camera and tree, restarting on any change
+#	-DPROGRESSIVE=1
+# Re-render only the screen areas of voxels moved since the last frames, dilated by the AO reach set with -dirty_radius
+#	-DDIRTY_REGION=1
 # Clang static code analysis:
 #	--analyze
 # Compiler quirk 0001: control definition location of routines posing entry points to recursion for more efficient inlining
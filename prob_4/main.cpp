@@ -21,6 +21,10 @@
 #error rogue iostream acquired
 #endif
 
+#if PROGRESSIVE != 0 && DIRTY_REGION != 0
+#error dirty-region re-rendering leaves the pixels of a static view be, leaving nothing for progressive accumulation
+#endif
+
 namespace stream {
 
 // deferred initialization by main()
@@ -37,6 +41,9 @@ static const char arg_fsaa[]		= "fsaa";
 static const char arg_nframes[]		= "frames";
 static const char arg_seed[]		= "seed";
 static const char arg_smooth[]		= "smooth";
+#if DIRTY_REGION != 0
+static const char arg_dirty_radius[]	= "dirty_radius";
+#endif
 
 static const size_t nthreads = WORKFORCE_NUM_THREADS;
 static const size_t one_less = nthreads - 1;
@@ -46,6 +53,30 @@ static const compile_assert< ao_probe_count % 4 == 0 > assert_ao_probe_count_eve
 static unsigned shape_seed = 42;
 static float offset = .0625f;
 
+#if PROGRESSIVE != 0
+// per-pixel AO accumulated over the frames of an unchanged view and scene
+struct Accum
+{
+	float lit; // cosine-weighted sum of the unoccluded probes
+	float all; // cosine-weighted sum of all probes
+};
+
+static Accum* accum;
+
+#endif
+#if DIRTY_REGION != 0
+// per-row span of pixels to re-shade, exclusive at the far end; empty when x0 >= x1
+struct Span
+{
+	uint16_t x0;
+	uint16_t x1;
+};
+
+static const Span* dirty;
+static float dirty_radius = 2.f; // reach of the AO influence of moved voxels
+
+#endif
+
 enum
 {
 	BARRIER_START,
@@ -128,6 +159,9 @@ shade(
 	const Ray& ray,
 	HitInfo& hit,
 	unsigned& seed,
+#if PROGRESSIVE != 0
+	Accum& acc,
+#endif
 	uint8_t (& pixel)[4])
 {
 	hit.target = PayloadId(-1);
@@ -252,8 +286,18 @@ shade(
 		lit = _mm_add_ps(lit, _mm_and_ps(cos_decl, _mm_castsi128_ps(shadow_hit)));
 	}
 
+#if PROGRESSIVE != 0
+	// add this frame's probes to those of the prior frames of the same view and scene
+	acc.lit += lit[0] + lit[1] + lit[2] + lit[3];
+	acc.all += all[0] + all[1] + all[2] + all[3];
+
+	const float intensity = sqrtf(acc.lit / acc.all);
+
+#else
 	const float intensity = sqrtf((lit[0] + lit[1] + lit[2] + lit[3]) / (all[0] + all[1] + all[2] + all[3]));
 
+#endif
+
 	pixel[0] = uint8_t(255.f * intensity);
 	pixel[1] = uint8_t(255.f * intensity);
 	pixel[2] = uint8_t(255.f * intensity);
@@ -337,14 +381,25 @@ frame_loop:
 				if ((y ^ x) % 2 != frame % 2)
 					continue;
 
+#if DIRTY_REGION != 0
+				if (x < dirty[y].x0 || x >= dirty[y].x1)
+					continue;
+
+#endif
 				const simd::vect3 offs = simd::vect3().add(
 					simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
 					simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
 
 				const Ray ray(simd::vect3().add(cam[3], offs), cam[2]);
 
+#if PROGRESSIVE != 0
+				shade(*ts, ray, carg->hit, carg->seed, accum[linear], framebuffer[linear]);
+
+#else
 				shade(*ts, ray, carg->hit, carg->seed, framebuffer[linear]);
 
+#endif
+
 #if COLORIZE_THREADS == 1
 				framebuffer[y * w + x][id % 4] += 32;
 
@@ -373,14 +428,25 @@ frame_loop:
 			if ((y ^ x) % 2 != frame % 2)
 				continue;
 
+#if DIRTY_REGION != 0
+			if (x < dirty[y].x0 || x >= dirty[y].x1)
+				continue;
+
+#endif
 			const simd::vect3 offs = simd::vect3().add(
 				simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
 				simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
 
 			const Ray ray(simd::vect3().add(cam[3], offs), cam[2]);
 
+#if PROGRESSIVE != 0
+			shade(*ts, ray, carg->hit, carg->seed, accum[y * w + x], framebuffer[y * w + x]);
+
+#else
 			shade(*ts, ray, carg->hit, carg->seed, framebuffer[y * w + x]);
 
+#endif
+
 #if COLORIZE_THREADS == 1
 			framebuffer[y * w + x][id % 4] += 32;
 
@@ -402,14 +468,25 @@ frame_loop:
 			if ((y ^ x) / 2 % nthreads != id)
 				continue;
 
+#if DIRTY_REGION != 0
+			if (x < dirty[y].x0 || x >= dirty[y].x1)
+				continue;
+
+#endif
 			const simd::vect3 offs = simd::vect3().add(
 				simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
 				simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
 
 			const Ray ray(simd::vect3().add(cam[3], offs), cam[2]);
 
+#if PROGRESSIVE != 0
+			shade(*ts, ray, carg->hit, carg->seed, accum[y * w + x], framebuffer[y * w + x]);
+
+#else
 			shade(*ts, ray, carg->hit, carg->seed, framebuffer[y * w + x]);
 
+#endif
+
 #if COLORIZE_THREADS == 1
 			framebuffer[y * w + x][id % 4] += 32;
 
@@ -792,6 +869,16 @@ parse_cli(
 			continue;
 		}
 
+#if DIRTY_REGION != 0
+		if (!strcmp(argv[i] + prefix_len, arg_dirty_radius))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%f", &dirty_radius)) || !(0.f <= dirty_radius))
+				success = false;
+
+			continue;
+		}
+
+#endif
 		success = false;
 	}
 
@@ -804,7 +891,11 @@ parse_cli(
 			"\t" << arg_prefix << arg_fsaa << " <positive_integer>\t\t: set GL fullscreen antialiasing; default is none\n"
 			"\t" << arg_prefix << arg_nframes << " <unsigned_integer>\t\t: set number of frames to run; default is max unsigned int\n"
 			"\t" << arg_prefix << arg_seed << " <unsigned_integer>\t\t: set game's PRNG seed\n"
-			"\t" << arg_prefix << arg_smooth << "\t\t\t\t\t: align pieces, forming a smooth wall\n";
+			"\t" << arg_prefix << arg_smooth << "\t\t\t\t\t: align pieces, forming a smooth wall\n"
+#if DIRTY_REGION != 0
+			"\t" << arg_prefix << arg_dirty_radius << " <non-negative_float>\t: set reach of the AO influence of moved voxels; default is 2\n"
+#endif
+			;
 
 		return 1;
 	}
@@ -1199,6 +1290,103 @@ game_frame(
 		stream::cerr << "game error: failed setting tree payload\n";
 }
 
+#if DIRTY_REGION != 0
+// check whether two voxels span the same box
+static bool
+same_voxel(
+	const Voxel& a,
+	const Voxel& b)
+{
+	return 7 == (7 &
+		_mm_movemask_ps(_mm_cmpeq_ps(a.get_bbox().get_min(), b.get_bbox().get_min())) &
+		_mm_movemask_ps(_mm_cmpeq_ps(a.get_bbox().get_max(), b.get_bbox().get_max())));
+}
+
+// grow the dirty spans of rows by the screen rectangle covered by a voxel dilated by the AO reach, under the given
+// camera; the projection is orthographic, along cam[2], with cam[0] and cam[1] spanning the screen
+static void
+mark_dirty(
+	const Voxel& voxel,
+	const simd::vect3 (& cam)[4],
+	const unsigned w,
+	const unsigned h,
+	Span* const span)
+{
+	const __m128 reach = _mm_set1_ps(dirty_radius);
+	const __m128 min = _mm_sub_ps(voxel.get_bbox().get_min(), reach);
+	const __m128 max = _mm_add_ps(voxel.get_bbox().get_max(), reach);
+
+	const float rcp_len0 = 1.f / cam[0].dot(cam[0]);
+	const float rcp_len1 = 1.f / cam[1].dot(cam[1]);
+
+	float x0 = w;
+	float y0 = h;
+	float x1 = 0.f;
+	float y1 = 0.f;
+
+	for (size_t i = 0; i < 8; ++i)
+	{
+		const simd::vect3 corner(
+			i & 1 ? max[0] : min[0],
+			i & 2 ? max[1] : min[1],
+			i & 4 ? max[2] : min[2]);
+		const simd::vect3 d = simd::vect3().sub(corner, cam[3]);
+
+		// invert the ray origins of shade: (2 * x - w) / w and (2 * y - h) / h along cam[0] and cam[1], respectively
+		const float x = (d.dot(cam[0]) * rcp_len0 + 1.f) * (w * .5f);
+		const float y = (d.dot(cam[1]) * rcp_len1 + 1.f) * (h * .5f);
+
+		x0 = std::min(x0, x);
+		y0 = std::min(y0, y);
+		x1 = std::max(x1, x);
+		y1 = std::max(y1, y);
+	}
+
+	// pixel rays pass through the pixel corners, so pad the rectangle by a pixel
+	const unsigned px0 = unsigned(std::max(x0 - 1.f, 0.f));
+	const unsigned py0 = unsigned(std::max(y0 - 1.f, 0.f));
+	const unsigned px1 = unsigned(std::min(x1 + 2.f, float(w)));
+	const unsigned py1 = unsigned(std::min(y1 + 2.f, float(h)));
+
+	for (unsigned y = py0; y < py1; ++y)
+		if (px0 < px1)
+		{
+			if (span[y].x0 >= span[y].x1)
+			{
+				span[y].x0 = px0;
+				span[y].x1 = px1;
+				continue;
+			}
+
+			span[y].x0 = std::min(unsigned(span[y].x0), px0);
+			span[y].x1 = std::max(unsigned(span[y].x1), px1);
+		}
+}
+
+#endif
+#if PROGRESSIVE != 0
+// FNV-1a hash, over 32-bit words, of the camera vectors and the tree version -- the key of the AO accumulation
+static uint64_t
+hash_view(
+	const simd::vect3 (& cam)[4],
+	const uint32_t version)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < 4; ++i)
+		for (size_t j = 0; j < 3; ++j)
+		{
+			const float f = cam[i][j];
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			hash = (hash ^ bits) * 0x100000001b3ULL;
+		}
+
+	return (hash ^ version) * 0x100000001b3ULL;
+}
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // this is a marker for the diff tool to spot main easier this is a marker for
 // this is a marker for the diff tool to spot main easier this is a marker for
@@ -1345,6 +1533,46 @@ int main(
 	uint8_t (* const framebuffer)[4] = reinterpret_cast< uint8_t(*)[4] >(uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad));
 	memset(framebuffer, 0, frame_size);
 
+#if PROGRESSIVE != 0
+	const size_t accum_size = w * h * sizeof(Accum);
+
+	const testbed::scoped_ptr< Accum, generic_free > unaligned_accum(
+		reinterpret_cast< Accum* >(malloc(accum_size + cacheline_pad)));
+
+	// get the accumulation buffer cacheline aligned as well
+	accum = reinterpret_cast< Accum* >(uintptr_t(unaligned_accum()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad));
+
+	uint64_t accum_key = 0;
+	size_t accum_resets = 0;
+	size_t accum_frames = 0;
+
+#endif
+#if DIRTY_REGION != 0
+	// dirty spans of this frame, of the previous frame, and of the pixels to re-shade -- those of either frame, as each
+	// frame shades only its own half of the pixels
+	const testbed::scoped_ptr< Span, generic_free > dirty_span(
+		reinterpret_cast< Span* >(malloc(h * 3 * sizeof(Span))));
+
+	Span* span_curr = dirty_span();
+	Span* span_prev = dirty_span() + h;
+	Span* const span_shade = dirty_span() + h * 2;
+	dirty = span_shade;
+	memset(dirty_span(), 0, h * 3 * sizeof(Span));
+
+	Array< Voxel > payload_prev;
+
+	if (!payload_prev.setCapacity(128))
+	{
+		stream::cerr << "failed to allocate payload history; bailing out\n";
+		return -1;
+	}
+
+	simd::vect3 cam_prev[4];
+	uint64_t dirty_shaded = 0;
+	uint64_t dirty_total = 0;
+	float dirty_fraction_max = 0.f;
+
+#endif
 	workforce_t workforce(framebuffer, w, h);
 
 	if (!workforce.is_successfully_init())
@@ -1453,6 +1681,99 @@ int main(
 		// note: normalisation above is not needed by the tracing arithmetic, but as
 		// a source of micro-jitter, helpful when tracing at orthographic projection
 
+#if DIRTY_REGION != 0
+		// mark dirty the screen areas of the voxels which either appeared or vanished since the previous frame, or all of
+		// the screen if the camera moved
+		bool cam_moved = 0 == nframes;
+
+		for (size_t i = 0; i < 4; ++i)
+			for (size_t j = 0; j < 3; ++j)
+				cam_moved = cam_moved || cam[i][j] != cam_prev[i][j];
+
+		for (size_t i = 0; i < 4; ++i)
+			cam_prev[i] = cam[i];
+
+		for (unsigned y = 0; y < h; ++y)
+		{
+			span_curr[y].x0 = cam_moved ? 0 : w;
+			span_curr[y].x1 = cam_moved ? w : 0;
+		}
+
+		if (!cam_moved)
+		{
+			for (size_t i = 0; i < payload.getCount(); ++i)
+			{
+				bool found = false;
+
+				for (size_t j = 0; j < payload_prev.getCount() && !found; ++j)
+					found = same_voxel(payload.getElement(i), payload_prev.getElement(j));
+
+				if (!found)
+					mark_dirty(payload.getElement(i), cam, w, h, span_curr);
+			}
+
+			for (size_t i = 0; i < payload_prev.getCount(); ++i)
+			{
+				bool found = false;
+
+				for (size_t j = 0; j < payload.getCount() && !found; ++j)
+					found = same_voxel(payload_prev.getElement(i), payload.getElement(j));
+
+				if (!found)
+					mark_dirty(payload_prev.getElement(i), cam, w, h, span_curr);
+			}
+		}
+
+		payload_prev.resetCount();
+
+		for (size_t i = 0; i < payload.getCount(); ++i)
+			payload_prev.addElement(payload.getElement(i));
+
+		// merge the spans of this and the previous frame, and count the pixels of this frame's half among them
+		uint64_t shaded = 0;
+
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const Span& curr = span_curr[y];
+			const Span& prev = span_prev[y];
+			Span& span = span_shade[y];
+
+			span = curr.x0 < curr.x1 ? curr : prev;
+
+			if (curr.x0 < curr.x1 && prev.x0 < prev.x1)
+			{
+				span.x0 = std::min(curr.x0, prev.x0);
+				span.x1 = std::max(curr.x1, prev.x1);
+			}
+
+			// pixels of this frame's half have x of the parity of y ^ frame
+			if (span.x0 < span.x1)
+				shaded += (span.x1 - span.x0 + ((span.x0 ^ y ^ nframes) & 1 ? 0 : 1)) / 2;
+		}
+
+		std::swap(span_curr, span_prev);
+
+		const uint64_t total = (uint64_t(w) * h + 1) / 2;
+		dirty_shaded += shaded;
+		dirty_total += total;
+		dirty_fraction_max = std::max(dirty_fraction_max, float(shaded) / total);
+
+#endif
+#if PROGRESSIVE != 0
+		// keep accumulating AO while neither the view nor the scene changes, start over otherwise
+		const uint64_t key = hash_view(cam, ts.get_version());
+
+		if (0 == nframes || key != accum_key)
+		{
+			memset(accum, 0, accum_size);
+			accum_key = key;
+			accum_frames = 0;
+			++accum_resets;
+		}
+
+		++accum_frames;
+
+#endif
 		workforce.update(nframes, cam, ts);
 
 #if DIVISION_OF_LABOR_VER == 2
@@ -1480,6 +1801,17 @@ int main(
 		"\nworker threads: " << nthreads << "\nambient occlusion rays per pixel: " << ao_probe_count <<
 		"\ntotal frames rendered: " << nframes << '\n';
 
+#if DIRTY_REGION != 0
+	stream::cout << "pixels re-rendered per frame: " << (dirty_total ? 100.0 * dirty_shaded / dirty_total : 0.0) <<
+		"% on average, " << 100.f * dirty_fraction_max << "% at most\n";
+
+#endif
+#if PROGRESSIVE != 0
+	stream::cout << "AO accumulation resets: " << accum_resets <<
+		"\nframes accumulated into the last image: " << accum_frames << '\n';
+
+#endif
+
 	if (sequence_dt)
 	{
 		const double sec = double(sequence_dt) * 1e-9;
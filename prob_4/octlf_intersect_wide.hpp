@@ -100,6 +100,24 @@ octet_intersect_wide(
 
 	// compute intersection distances (use distance-to-exit)
 
+#if INTERSECT16 != 0
+	__m256 t_min;
+	__m256 t_max;
+
+	const __mmask8 hit = intersect16(
+		bbox_min_x,
+		bbox_min_y,
+		bbox_min_z,
+		bbox_max_x,
+		bbox_max_y,
+		bbox_max_z,
+		ray, t_min, t_max);
+
+	// filter out empty nodes, then sort the rest
+	return compress_sort8(hit & ~_mm_movepi16_mask(octet.get_occupancy()), t_max, child_index);
+
+#else
+
 #if __AVX__ != 0
 	float t[8] __attribute__ ((aligned(sizeof(__m256))));
 	uint32_t r[8] __attribute__ ((aligned(sizeof(__m256))));
@@ -296,6 +314,8 @@ octet_intersect_wide(
 	*(__m128*)(child_index.index + 4) = _mm_unpackhi_ps(r5x_min, r5x_max);
 
 	return count;
+
+#endif // INTERSECT16
 }
 
 #endif // octlf_intersect_wide_H__
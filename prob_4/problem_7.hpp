@@ -13,6 +13,7 @@
 #include <istream>
 #include <ostream>
 #include <limits>
+#include <algorithm>
 #include "vectsimd_sse.hpp"
 #include "array.hpp"
 #include "array_lite.hpp"
@@ -80,6 +81,27 @@ public:
 		m_rcpdir_y = _mm_shuffle_ps(m_rcpdir.getn(), m_rcpdir.getn(), 0x55);
 		m_rcpdir_z = _mm_shuffle_ps(m_rcpdir.getn(), m_rcpdir.getn(), 0xaa);
 
+#endif
+	}
+
+	// construct from a direction of precomputed reciprocal, which has infinities substituted for max floats
+	Ray(
+		const simd::vect3& origin,
+		const simd::vect3& direction,
+		const simd::vect3& rcpdir)
+	: m_origin(origin)
+	, m_direction(direction)
+	, m_rcpdir(rcpdir)
+	{
+#if __AVX__ == 0
+		m_origin_x = _mm_shuffle_ps(origin.getn(), origin.getn(), 0);
+		m_origin_y = _mm_shuffle_ps(origin.getn(), origin.getn(), 0x55);
+		m_origin_z = _mm_shuffle_ps(origin.getn(), origin.getn(), 0xaa);
+
+		m_rcpdir_x = _mm_shuffle_ps(rcpdir.getn(), rcpdir.getn(), 0);
+		m_rcpdir_y = _mm_shuffle_ps(rcpdir.getn(), rcpdir.getn(), 0x55);
+		m_rcpdir_z = _mm_shuffle_ps(rcpdir.getn(), rcpdir.getn(), 0xaa);
+
 #endif
 	}
 
@@ -785,6 +807,64 @@ intersect8(
 
 #endif // __AVX__ != 0
 
+#if INTERSECT16 != 0 && (__AVX512F__ == 0 || __AVX512VL__ == 0 || __AVX512DQ__ == 0 || __AVX512BW__ == 0)
+// the 16-lane intersection needs AVX-512 F/VL/DQ/BW; units built for lesser ISA levels go without it
+#undef INTERSECT16
+
+#endif
+#if INTERSECT16 != 0
+//
+// ray/octo-box intersection over 16 lanes - min planes in the low, max planes in the high half-register - yielding mask
+// and numeric results (min and max t)
+//
+
+inline __mmask8 __attribute__ ((always_inline))
+intersect16(
+	const __m256 & bbox_min_x,
+	const __m256 & bbox_min_y,
+	const __m256 & bbox_min_z,
+	const __m256 & bbox_max_x,
+	const __m256 & bbox_max_y,
+	const __m256 & bbox_max_z,
+	const Ray& ray,
+	__m256& t_min,
+	__m256& t_max)
+{
+	// the parametric dot(normal, origin + t * direction) = distance
+	// yields t = (distance - dot(normal, origin)) / dot(normal, direction)
+
+	const __m512 t_x = _mm512_mul_ps(
+		_mm512_sub_ps(_mm512_insertf32x8(_mm512_castps256_ps512(bbox_min_x), bbox_max_x, 1), _mm512_set1_ps(ray.get_origin()[0])),
+		_mm512_set1_ps(ray.get_rcpdir()[0]));
+	const __m512 t_y = _mm512_mul_ps(
+		_mm512_sub_ps(_mm512_insertf32x8(_mm512_castps256_ps512(bbox_min_y), bbox_max_y, 1), _mm512_set1_ps(ray.get_origin()[1])),
+		_mm512_set1_ps(ray.get_rcpdir()[1]));
+	const __m512 t_z = _mm512_mul_ps(
+		_mm512_sub_ps(_mm512_insertf32x8(_mm512_castps256_ps512(bbox_min_z), bbox_max_z, 1), _mm512_set1_ps(ray.get_origin()[2])),
+		_mm512_set1_ps(ray.get_rcpdir()[2]));
+
+	// swap halves to pair up min and max planes
+	const __m512 s_x = _mm512_shuffle_f32x4(t_x, t_x, 0x4e);
+	const __m512 s_y = _mm512_shuffle_f32x4(t_y, t_y, 0x4e);
+	const __m512 s_z = _mm512_shuffle_f32x4(t_z, t_z, 0x4e);
+
+	// per-axis entries in the low half, negated per-axis exits in the high half, so a single max yields both results
+	const __mmask16 high = 0xff00;
+	const __m512 x = _mm512_mask_sub_ps(_mm512_min_ps(t_x, s_x), high, _mm512_setzero_ps(), _mm512_max_ps(t_x, s_x));
+	const __m512 y = _mm512_mask_sub_ps(_mm512_min_ps(t_y, s_y), high, _mm512_setzero_ps(), _mm512_max_ps(t_y, s_y));
+	const __m512 z = _mm512_mask_sub_ps(_mm512_min_ps(t_z, s_z), high, _mm512_setzero_ps(), _mm512_max_ps(t_z, s_z));
+
+	const __m512 t = _mm512_max_ps(_mm512_max_ps(x, y), z);
+
+	t_min = _mm512_castps512_ps256(t);
+	t_max = _mm256_sub_ps(_mm256_setzero_ps(), _mm512_extractf32x8_ps(t, 1));
+
+	// discard non-intersections (min >= max) and intersections at non-positive distances
+	return _mm256_cmp_ps_mask(t_min, t_max, _CMP_LT_OQ) & _mm256_cmp_ps_mask(_mm256_setzero_ps(), t_max, _CMP_LT_OQ);
+}
+
+#endif // INTERSECT16 != 0
+
 class Voxel
 {
 	BBox m_bbox;
@@ -962,6 +1042,29 @@ enum {
 static const compile_assert< (size_t(1) << sizeof(OctetId) * 8 > octree_leaf_count) > assert_octet_id;
 static const compile_assert< (size_t(1) << sizeof(PayloadId) * 8 > octree_payload_count) > assert_payload_id;
 
+#if LEAF_PAYLOAD_SOA != 0
+enum {
+	payload_block_capacity = 8
+};
+
+static const compile_assert< cell_capacity % payload_block_capacity == 0 > assert_cell_capacity;
+
+//
+// SoA copy of eight consecutive payload voxels
+//
+
+struct __attribute__ ((aligned(64))) PayloadBlock
+{
+	float min_x[payload_block_capacity];
+	float min_y[payload_block_capacity];
+	float min_z[payload_block_capacity];
+	float max_x[payload_block_capacity];
+	float max_y[payload_block_capacity];
+	float max_z[payload_block_capacity];
+};
+
+#endif // LEAF_PAYLOAD_SOA
+
 
 class __attribute__ ((aligned(16))) Octet
 {
@@ -1093,6 +1196,11 @@ public:
 			if (0 == cell_count)
 				continue;
 
+#if LEAF_PAYLOAD_SOA != 0
+			// start cells at payload-block boundaries
+			cursor = cursor + payload_block_capacity - 1 & ~size_t(payload_block_capacity - 1);
+
+#endif
 			for (size_t j = 0; j < cell_count; ++j)
 				payload.getMutable(cursor + j) = payload.getElement(cell_start + j);
 
@@ -1111,6 +1219,64 @@ struct __attribute__ ((aligned(64))) ChildIndex
 
 static const compile_assert< 64 == sizeof(ChildIndex) > assert_child_index_size;
 
+#if INTERSECT16 != 0
+inline void __attribute__ ((always_inline))
+sort8_stage(
+	__m256& t,
+	__m256i& x,
+	const __m256i perm,
+	const __mmask8 keep_min)
+{
+	const __m256 tp = _mm256_permutevar8x32_ps(t, perm);
+	const __m256i xp = _mm256_permutevar8x32_epi32(x, perm);
+
+	// min-keeping lanes take a lesser partner, max-keeping lanes take a greater partner
+	const __mmask8 take =
+		keep_min & _mm256_cmp_ps_mask(tp, t, _CMP_LT_OQ) |
+		~keep_min & _mm256_cmp_ps_mask(tp, t, _CMP_GT_OQ);
+
+	t = _mm256_mask_blend_ps(take, t, tp);
+	x = _mm256_mask_blend_epi32(take, x, xp);
+}
+
+//
+// compress the hit children of an octet to the front and sort them in ascending order of distance; return hit count
+//
+
+inline size_t __attribute__ ((always_inline))
+compress_sort8(
+	const __mmask8 hit,
+	const __m256 t,
+	ChildIndex& child_index)
+{
+	__m256 dist = _mm256_mask_compress_ps(_mm256_set1_ps(std::numeric_limits< float >::infinity()), hit, t);
+	__m256i index = _mm256_maskz_compress_epi32(hit, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+	const size_t count = __builtin_popcount(hit);
+
+	// use Ken Batcher's bitonic sorting network for 8 elements, but only when there's anything to sort
+	if (1 < count)
+	{
+		const __m256i swap1 = _mm256_setr_epi32(1, 0, 3, 2, 5, 4, 7, 6);
+		const __m256i swap2 = _mm256_setr_epi32(2, 3, 0, 1, 6, 7, 4, 5);
+		const __m256i swap4 = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
+
+		sort8_stage(dist, index, swap1, 0x99);
+		sort8_stage(dist, index, swap2, 0xc3);
+		sort8_stage(dist, index, swap1, 0xa5);
+		sort8_stage(dist, index, swap4, 0x0f);
+		sort8_stage(dist, index, swap2, 0x33);
+		sort8_stage(dist, index, swap1, 0x55);
+	}
+
+	_mm256_store_ps(child_index.distance, dist);
+	_mm256_store_si256(reinterpret_cast< __m256i* >(child_index.index), index);
+
+	return count;
+}
+
+#endif // INTERSECT16
+
 #if __SSE4_1__ == 0
 inline __m128 __attribute__ ((always_inline))
 _nn_blend_ps(
@@ -1161,6 +1327,164 @@ _nn_blendv_ps(
 
 #endif // __SSE4_1__
 
+#if LEAF_PAYLOAD_SOA != 0
+//
+// SoA ray/octo-box intersection yielding the lane of the nearest box among the first 'count' in the block which is not
+// of id 'skip' and whose non-negative entry distance is less than 'dist'; that distance gets updated on success
+//
+
+inline int __attribute__ ((always_inline))
+intersect8_nearest(
+	const PayloadBlock& block,
+	const PayloadId* const id,
+	const size_t count,
+	const PayloadId skip,
+	const Ray& ray,
+	float& dist)
+{
+	// eligible lanes: within count and not skipped
+	const __m128i lane = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i elig = _mm_andnot_si128(
+		_mm_cmpeq_epi16(_mm_load_si128(reinterpret_cast< const __m128i* >(id)), _mm_set1_epi16(skip)),
+		_mm_cmplt_epi16(lane, _mm_set1_epi16(count)));
+
+#if __AVX__ != 0
+	const __m256 tmin_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.min_x), ray.get_origin_x()), ray.get_rcpdir_x());
+	const __m256 tmax_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.max_x), ray.get_origin_x()), ray.get_rcpdir_x());
+	const __m256 tmin_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.min_y), ray.get_origin_y()), ray.get_rcpdir_y());
+	const __m256 tmax_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.max_y), ray.get_origin_y()), ray.get_rcpdir_y());
+	const __m256 tmin_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.min_z), ray.get_origin_z()), ray.get_rcpdir_z());
+	const __m256 tmax_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.max_z), ray.get_origin_z()), ray.get_rcpdir_z());
+
+	const __m256 min = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tmin_x, tmax_x), _mm256_min_ps(tmin_y, tmax_y)), _mm256_min_ps(tmin_z, tmax_z));
+	const __m256 max = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tmin_x, tmax_x), _mm256_max_ps(tmin_y, tmax_y)), _mm256_max_ps(tmin_z, tmax_z));
+
+	// same criteria as BBox::intersect: discard non-intersections (min > max) and intersections at negative entry
+	// distances; also discard anything not nearer than the current distance, as well as the non-eligible lanes
+	const __m256 msk = _mm256_and_ps(_mm256_and_ps(
+		_mm256_and_ps(_mm256_cmp_ps(min, max, _CMP_LE_OQ), _mm256_cmp_ps(_mm256_setzero_ps(), min, _CMP_LE_OQ)),
+		_mm256_cmp_ps(min, _mm256_set1_ps(dist), _CMP_LT_OQ)),
+		_mm256_castsi256_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(elig, elig)), _mm_unpackhi_epi16(elig, elig), 1)));
+
+	const int hit = _mm256_movemask_ps(msk);
+
+	if (0 == hit)
+		return -1;
+
+	// horizontal min-reduce
+	const __m256 t = _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits< float >::infinity()), min, msk);
+	__m256 t_min = _mm256_min_ps(t, _mm256_permute2f128_ps(t, t, 0x01));
+	t_min = _mm256_min_ps(t_min, _mm256_shuffle_ps(t_min, t_min, 0x4e));
+	t_min = _mm256_min_ps(t_min, _mm256_shuffle_ps(t_min, t_min, 0xb1));
+
+	dist = _mm256_cvtss_f32(t_min);
+
+	// first nearest lane, in case of a tie
+	return __builtin_ctz(hit & _mm256_movemask_ps(_mm256_cmp_ps(t, t_min, _CMP_EQ_OQ)));
+
+#else
+	const __m128 ray_origin_x = ray.get_origin_x();
+	const __m128 ray_origin_y = ray.get_origin_y();
+	const __m128 ray_origin_z = ray.get_origin_z();
+	const __m128 ray_rcpdir_x = ray.get_rcpdir_x();
+	const __m128 ray_rcpdir_y = ray.get_rcpdir_y();
+	const __m128 ray_rcpdir_z = ray.get_rcpdir_z();
+
+	__m128 t[2];
+	int hit = 0;
+
+	for (size_t i = 0; i < 2; ++i)
+	{
+		const __m128 tmin_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.min_x + i * 4), ray_origin_x), ray_rcpdir_x);
+		const __m128 tmax_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.max_x + i * 4), ray_origin_x), ray_rcpdir_x);
+		const __m128 tmin_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.min_y + i * 4), ray_origin_y), ray_rcpdir_y);
+		const __m128 tmax_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.max_y + i * 4), ray_origin_y), ray_rcpdir_y);
+		const __m128 tmin_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.min_z + i * 4), ray_origin_z), ray_rcpdir_z);
+		const __m128 tmax_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.max_z + i * 4), ray_origin_z), ray_rcpdir_z);
+
+		const __m128 min = _mm_max_ps(_mm_max_ps(_mm_min_ps(tmin_x, tmax_x), _mm_min_ps(tmin_y, tmax_y)), _mm_min_ps(tmin_z, tmax_z));
+		const __m128 max = _mm_min_ps(_mm_min_ps(_mm_max_ps(tmin_x, tmax_x), _mm_max_ps(tmin_y, tmax_y)), _mm_max_ps(tmin_z, tmax_z));
+
+		// same criteria as BBox::intersect: discard non-intersections (min > max) and intersections at negative entry
+		// distances; also discard anything not nearer than the current distance, as well as the non-eligible lanes
+		const __m128 msk = _mm_and_ps(_mm_and_ps(
+			_mm_and_ps(_mm_cmple_ps(min, max), _mm_cmple_ps(_mm_setzero_ps(), min)),
+			_mm_cmplt_ps(min, _mm_set1_ps(dist))),
+			_mm_castsi128_ps(0 == i ? _mm_unpacklo_epi16(elig, elig) : _mm_unpackhi_epi16(elig, elig)));
+
+		t[i] = _nn_blendv_ps(_mm_set1_ps(std::numeric_limits< float >::infinity()), min, msk);
+		hit |= _mm_movemask_ps(msk) << i * 4;
+	}
+
+	if (0 == hit)
+		return -1;
+
+	// horizontal min-reduce
+	__m128 t_min = _mm_min_ps(t[0], t[1]);
+	t_min = _mm_min_ps(t_min, _mm_shuffle_ps(t_min, t_min, 0x4e));
+	t_min = _mm_min_ps(t_min, _mm_shuffle_ps(t_min, t_min, 0xb1));
+
+	dist = _mm_cvtss_f32(t_min);
+
+	// first nearest lane, in case of a tie
+	return __builtin_ctz(hit &
+		(_mm_movemask_ps(_mm_cmpeq_ps(t[0], t_min)) | _mm_movemask_ps(_mm_cmpeq_ps(t[1], t_min)) << 4));
+
+#endif
+}
+
+//
+// SoA ray/octo-box intersection yielding whether any of the first 'count' boxes in the block, not of id 'skip', is hit
+//
+
+inline bool __attribute__ ((always_inline))
+intersect8_any(
+	const PayloadBlock& block,
+	const PayloadId* const id,
+	const size_t count,
+	const PayloadId skip,
+	const Ray& ray)
+{
+	// eligible lanes: within count and not skipped
+	const __m128i lane = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i elig = _mm_andnot_si128(
+		_mm_cmpeq_epi16(_mm_load_si128(reinterpret_cast< const __m128i* >(id)), _mm_set1_epi16(skip)),
+		_mm_cmplt_epi16(lane, _mm_set1_epi16(count)));
+
+	float t[8] __attribute__ ((aligned(32)));
+	uint32_t r[8] __attribute__ ((aligned(32)));
+
+#if __AVX__ != 0
+	intersect8(
+		_mm256_load_ps(block.min_x),
+		_mm256_load_ps(block.min_y),
+		_mm256_load_ps(block.min_z),
+		_mm256_load_ps(block.max_x),
+		_mm256_load_ps(block.max_y),
+		_mm256_load_ps(block.max_z),
+		ray, t, r);
+
+#else
+	const __m128 min_x[] = { _mm_load_ps(block.min_x), _mm_load_ps(block.min_x + 4) };
+	const __m128 min_y[] = { _mm_load_ps(block.min_y), _mm_load_ps(block.min_y + 4) };
+	const __m128 min_z[] = { _mm_load_ps(block.min_z), _mm_load_ps(block.min_z + 4) };
+	const __m128 max_x[] = { _mm_load_ps(block.max_x), _mm_load_ps(block.max_x + 4) };
+	const __m128 max_y[] = { _mm_load_ps(block.max_y), _mm_load_ps(block.max_y + 4) };
+	const __m128 max_z[] = { _mm_load_ps(block.max_z), _mm_load_ps(block.max_z + 4) };
+
+	intersect8(min_x, min_y, min_z, max_x, max_y, max_z, ray, t, r);
+
+#endif
+	// narrow the 32-bit hit masks down to 16-bit ones
+	const __m128i hit = _mm_packs_epi32(
+		_mm_load_si128(reinterpret_cast< const __m128i* >(r + 0)),
+		_mm_load_si128(reinterpret_cast< const __m128i* >(r + 4)));
+
+	return 0 != _mm_movemask_epi8(_mm_and_si128(hit, elig));
+}
+
+#endif // LEAF_PAYLOAD_SOA
+
 struct HitInfo
 {
 	__m128 min_mask;
@@ -1171,6 +1495,42 @@ struct HitInfo
 	PayloadId target;
 };
 
+#if BEAM_PREPASS != 0
+// entry point to the tree for a bundle of rays: the deepest node whose subtree holds every hit of the bundle; a level
+// of octree_level_count stands for no node, i.e. the bundle misses the tree
+struct BeamEntry
+{
+	BBox bbox;
+	uint32_t level;
+	uint32_t index; // into the interior octets, or into the leaves at octree_level_leaf
+};
+
+// test if a bbox may overlap a cone, given by its apex and the normals of its bounding planes through the apex, facing
+// inward; conservative -- may report an overlap where there is none
+inline bool
+cone_overlap(
+	const BBox& bbox,
+	const __m128 apex,
+	const __m128 (& plane)[5])
+{
+	const __m128 min = _mm_sub_ps(bbox.get_min(), apex);
+	const __m128 max = _mm_sub_ps(bbox.get_max(), apex);
+
+	for (size_t i = 0; i < 5; ++i)
+	{
+		// the bbox corner furthest along the plane normal
+		const __m128 positive = _mm_cmpgt_ps(plane[i], _mm_setzero_ps());
+		const __m128 corner = _mm_or_ps(_mm_and_ps(positive, max), _mm_andnot_ps(positive, min));
+		const __m128 prod = _mm_mul_ps(corner, plane[i]);
+
+		if (prod[0] + prod[1] + prod[2] < 0.f)
+			return false;
+	}
+
+	return true;
+}
+
+#endif
 //
 // A sparse regular octree - pointer-less version
 //
@@ -1183,7 +1543,31 @@ enum {
 	octree_leaf_sizeof = octree_leaf_count * sizeof(Leaf),
 
 	octree_payload_offset = octree_leaf_offset + octree_leaf_sizeof,
-	octree_payload_sizeof = octree_payload_count * sizeof(Voxel)
+	octree_payload_sizeof = octree_payload_count * sizeof(Voxel),
+
+#if LEAF_PAYLOAD_SOA != 0
+	octree_payload_soa_offset = octree_payload_offset + octree_payload_sizeof + 63 & ~63,
+	octree_payload_soa_sizeof = octree_payload_count / payload_block_capacity * sizeof(PayloadBlock),
+
+	octree_payload_id_offset = octree_payload_soa_offset + octree_payload_soa_sizeof,
+	octree_payload_id_sizeof = octree_payload_count * sizeof(PayloadId),
+
+	octree_payload_end = octree_payload_id_offset + octree_payload_id_sizeof,
+
+#else
+	octree_payload_end = octree_payload_offset + octree_payload_sizeof,
+
+#endif
+#if HIT_PREDICTION != 0
+	octree_payload_index_offset = octree_payload_end,
+	octree_payload_index_sizeof = octree_payload_count * sizeof(PayloadId),
+
+	octree_sizeof = octree_payload_index_offset + octree_payload_index_sizeof
+
+#else
+	octree_sizeof = octree_payload_end
+
+#endif
 };
 
 struct TimesliceMimic // mimics the layout of Timeslice
@@ -1192,6 +1576,7 @@ struct TimesliceMimic // mimics the layout of Timeslice
 	ArrayLite< Octet, octree_interior_count, 0 > m_interior;
 	ArrayLite< Leaf, octree_leaf_count, 0 >      m_leaf;
 	ArrayLite< Voxel, octree_payload_count, 0 >  m_payload;
+	uint32_t m_version;
 };
 
 static const compile_assert< sizeof(TimesliceMimic) == octree_interior_offset > assert_sizeof_timeslicemimic;
@@ -1208,10 +1593,70 @@ class Timeslice
 	ArrayLite< Octet, octree_interior_count, octree_interior_relative_offset > m_interior;
 	ArrayLite< Leaf, octree_leaf_count, octree_leaf_relative_offset >          m_leaf;
 	ArrayLite< Voxel, octree_payload_count, octree_payload_relative_offset >   m_payload;
+	uint32_t m_version; // count of payload updates; fits in the padding ahead of the interior nodes
 
 	// following data members are thread-local and valid only for the duration of a traversal
 	static __thread const Ray* m_ray;
 	static __thread HitInfo* m_hit;
+#if HIT_PREDICTION != 0
+	static __thread float m_bound; // distance past which subtrees are not entered
+#endif
+#if AO_LOD != 0
+	static __thread float m_lod_slope;       // node extent per unit distance past which occupied nodes count as hits
+	static __thread uint64_t m_node_count;   // nodes visited by occlusion traversals
+
+	// get the largest extent of the given box
+	static float
+	max_extent(
+		const BBox& bbox)
+	{
+		const __m128 e = _mm_sub_ps(bbox.get_max(), bbox.get_min());
+		const __m128 e01 = _mm_max_ps(e, _mm_shuffle_ps(e, e, _MM_SHUFFLE(3, 0, 2, 1)));
+		return _mm_cvtss_f32(_mm_max_ss(e01, _mm_shuffle_ps(e, e, _MM_SHUFFLE(3, 1, 0, 2))));
+	}
+
+	// get the distance at which the given ray enters the given box; non-positive if the box encloses the ray origin
+	static float
+	entry_distance(
+		const Ray& ray,
+		const BBox& bbox)
+	{
+		const __m128 t0 = _mm_mul_ps(_mm_sub_ps(bbox.get_min(), ray.get_origin().getn()), ray.get_rcpdir().getn());
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(bbox.get_max(), ray.get_origin().getn()), ray.get_rcpdir().getn());
+		const __m128 t = _mm_min_ps(t0, t1);
+		const __m128 t01 = _mm_max_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 0, 2, 1)));
+		return _mm_cvtss_f32(_mm_max_ss(t01, _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 1, 0, 2))));
+	}
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+	static __thread uint64_t m_prefetch_count; // prefetches issued by traversals
+
+	// prefetch the cacheline holding the given traversal data
+	static void
+	prefetch(
+		const void* const p)
+	{
+		_mm_prefetch(reinterpret_cast< const char* >(p), _MM_HINT_T0);
+		++m_prefetch_count;
+	}
+
+	// prefetch the start of the payload of the given leaf cell
+	void
+	prefetch_payload(
+		const Leaf& leaf,
+		const size_t index) const
+	{
+#if LEAF_PAYLOAD_SOA != 0
+		prefetch(get_payload_block(leaf.get_start(index)));
+
+#else
+		prefetch(&m_payload.getElement(leaf.get_start(index)));
+
+#endif
+	}
+
+#endif
 
 	template < unsigned OCTREE_LEVEL_T >
 	bool
@@ -1246,6 +1691,64 @@ class Timeslice
 		const Leaf& leaf,
 		const BBox& bbox) const;
 
+#if BEAM_PREPASS != 0
+	template < unsigned OCTREE_LEVEL_T >
+	bool
+	traverse_from(
+		const BeamEntry& entry) const;
+
+#endif
+
+#if LEAF_PAYLOAD_SOA != 0
+	// SoA copy of the payload, along with the payload ids, both residing past the payload itself
+	PayloadBlock*
+	get_payload_block(
+		const size_t payload_index)
+	{
+		assert(0 == payload_index % payload_block_capacity);
+		return reinterpret_cast< PayloadBlock* >(uintptr_t(this) + uintptr_t(octree_payload_soa_offset)) + payload_index / payload_block_capacity;
+	}
+
+	const PayloadBlock*
+	get_payload_block(
+		const size_t payload_index) const
+	{
+		assert(0 == payload_index % payload_block_capacity);
+		return reinterpret_cast< const PayloadBlock* >(uintptr_t(this) + uintptr_t(octree_payload_soa_offset)) + payload_index / payload_block_capacity;
+	}
+
+	PayloadId*
+	get_payload_id(
+		const size_t payload_index)
+	{
+		return reinterpret_cast< PayloadId* >(uintptr_t(this) + uintptr_t(octree_payload_id_offset)) + payload_index;
+	}
+
+	const PayloadId*
+	get_payload_id(
+		const size_t payload_index) const
+	{
+		return reinterpret_cast< const PayloadId* >(uintptr_t(this) + uintptr_t(octree_payload_id_offset)) + payload_index;
+	}
+
+#endif
+#if HIT_PREDICTION != 0
+	// payload index by payload id, residing past all other payload data; ids not in the tree map to PayloadId(-1)
+	PayloadId*
+	get_payload_index(
+		const size_t id)
+	{
+		return reinterpret_cast< PayloadId* >(uintptr_t(this) + uintptr_t(octree_payload_index_offset)) + id;
+	}
+
+	const PayloadId*
+	get_payload_index(
+		const size_t id) const
+	{
+		return reinterpret_cast< const PayloadId* >(uintptr_t(this) + uintptr_t(octree_payload_index_offset)) + id;
+	}
+
+#endif
 	template < unsigned OCTREE_LEVEL_T >
 	bool
 	add_payload(
@@ -1261,6 +1764,7 @@ class Timeslice
 
 public:
 	Timeslice()
+	: m_version(0)
 	{
 	}
 
@@ -1268,12 +1772,24 @@ public:
 	set_payload_array(
 		const Array< Voxel >& arr);
 
+	// copy the tree to the given storage of octree_sizeof bytes, skipping the unpopulated capacity of the tree
+	void
+	replicate(
+		Timeslice& dst) const;
+
 	const BBox&
 	get_root_bbox() const
 	{
 		return m_root_bbox;
 	}
 
+	// get the count of payload updates, changing with every set_payload_array
+	uint32_t
+	get_version() const
+	{
+		return m_version;
+	}
+
 #if CLANG_QUIRK_0001 != 0
 	// we want the following methods always inlined, yet for some reason keeping their definitions in the translation
 	// unit, tagging them 'always_inline' here, and leaving the inlining to the LTO yields faster code; file a report?
@@ -1310,12 +1826,107 @@ public:
 		HitInfo& hit) const;
 
 #endif // CLANG_QUIRK_0001
+#if BEAM_PREPASS != 0
+	// find the beam entry for the bundle of rays within the cone of the given apex and edge directions, the latter given
+	// in cyclic order
+	void
+	find_beam_entry(
+		const simd::vect3& apex,
+		const simd::vect3 (& edge)[4],
+		BeamEntry& entry) const;
+
+	// closest-hit traversal starting from a beam entry of a bundle the ray belongs to
+	bool
+	traverse(
+		const Ray& ray,
+		HitInfo& hit,
+		const BeamEntry& entry) const
+	{
+		m_ray = &ray;
+		m_hit = &hit;
+
+		return traverse_from< octree_level_root >(entry);
+	}
+
+#endif
+#if AO_ANALYTIC != 0
+	// gather the ids of the payload items overlapping the given box, each id once, up to the given capacity; return the
+	// count of ids gathered
+	size_t
+	gather(
+		const BBox& box,
+		PayloadId* const id,
+		const size_t capacity) const;
+
+#endif
+#if AO_LOD != 0
+	// set the distance past which occupied leaf nodes count as hits to occlusion traversals by this thread, growing in
+	// proportion to node extent; zero for exact occlusion
+	void
+	set_lod_distance(
+		const float distance) const
+	{
+		m_lod_slope = 0.f == distance ? 0.f : max_extent(m_root_bbox) / float(1 << octree_level_leaf) / distance;
+	}
+
+	// get the number of nodes visited by this thread's occlusion traversals since the last call
+	static uint64_t
+	flush_node_count()
+	{
+		const uint64_t count = m_node_count;
+		m_node_count = 0;
+		return count;
+	}
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+	// get the number of prefetches issued by this thread's traversals since the last call
+	static uint64_t
+	flush_prefetch_count()
+	{
+		const uint64_t count = m_prefetch_count;
+		m_prefetch_count = 0;
+		return count;
+	}
+
+#endif
+#if HIT_PREDICTION != 0
+	// get the payload item of the given id, or null if no such item is in the tree
+	const Voxel*
+	get_payload(
+		const PayloadId id) const
+	{
+		if (octree_payload_count <= id)
+			return 0;
+
+		const PayloadId index = *get_payload_index(id);
+
+		if (PayloadId(-1) == index)
+			return 0;
+
+		return &m_payload.getElement(index);
+	}
+
+	// closest-hit traversal seeded with a hit of the ray on a payload item in the tree; seek only hits nearer than the
+	// seed, and prune any subtree entered past the seed; return true if a nearer hit replaced the seed in the hit info
+	bool
+	traverse_seeded(
+		const Ray& ray,
+		HitInfo& hit) const
+	{
+		m_bound = hit.dist;
+		const bool nearer = traverse(ray, hit);
+		m_bound = __builtin_inff();
+		return nearer;
+	}
+
+#endif
 };
 
 static const compile_assert< sizeof(Timeslice) == sizeof(TimesliceMimic) > assert_sizeof_timeslice;
 
 class __attribute__ ((aligned(4096))) TimesliceBalloon : public Timeslice {
-	int8_t air[octree_payload_offset + octree_payload_sizeof - sizeof(Timeslice)];
+	int8_t air[octree_sizeof - sizeof(Timeslice)];
 };
 
 #include "octet_intersect_wide.hpp"
@@ -1354,6 +1965,18 @@ Timeslice::traverse(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if HIT_PREDICTION != 0
+		// children are disjoint and sorted, so none is entered before its predecessor is exited
+		if (0 != i && child_index.distance[i - 1] > m_bound)
+			break;
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_interior.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1402,6 +2025,18 @@ Timeslice::traverse< octree_level_last_but_one >(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if HIT_PREDICTION != 0
+		// children are disjoint and sorted, so none is entered before its predecessor is exited
+		if (0 != i && child_index.distance[i - 1] > m_bound)
+			break;
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_leaf.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1453,8 +2088,44 @@ Timeslice::traverse(
 
 		assert(0 != payload_count);
 
+#if HIT_PREDICTION != 0
+		if (0 != i && child_index.distance[i - 1] > m_bound)
+			break;
+
+		float nearest_dist = child_index.distance[i] < m_bound ? child_index.distance[i] : m_bound;
+
+#else
 		float nearest_dist = child_index.distance[i];
 
+#endif
+#if TRAVERSE_PREFETCH != 0
+		// fetch the payload of the cells due next, while this cell is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch_payload(leaf, child_index.index[j]);
+
+#endif
+#if LEAF_PAYLOAD_SOA != 0
+		for (size_t j = payload_start; j < payload_start + payload_count; j += payload_block_capacity)
+		{
+			const int lane = intersect8_nearest(
+				*get_payload_block(j),
+				get_payload_id(j),
+				payload_start + payload_count - j,
+				prior_target,
+				ray,
+				nearest_dist);
+
+			if (0 > lane)
+				continue;
+
+			// redo the nearest hit as AoS for the plane-hit details
+			const Voxel& voxel = m_payload.getElement(j + lane);
+
+			voxel.get_bbox().intersect(ray, m_hit->min_mask, m_hit->a_mask, m_hit->b_mask, m_hit->dist);
+			m_hit->target = PayloadId(voxel.get_id());
+		}
+
+#else
 		for (size_t j = payload_start; j < payload_start + payload_count; ++j)
 		{
 			const Voxel& voxel = m_payload.getElement(j);
@@ -1481,6 +2152,8 @@ Timeslice::traverse(
 			}
 		}
 
+#endif
+
 		if (m_hit->target != prior_target)
 			return true;
 	}
@@ -1522,6 +2195,12 @@ Timeslice::traverse_lite(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_interior.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1570,6 +2249,12 @@ Timeslice::traverse_lite< octree_level_last_but_one >(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_leaf.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1615,6 +2300,31 @@ Timeslice::traverse_lite(
 
 		float nearest_dist = child_index.distance[i];
 
+#if TRAVERSE_PREFETCH != 0
+		// fetch the payload of the cells due next, while this cell is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch_payload(leaf, child_index.index[j]);
+
+#endif
+#if LEAF_PAYLOAD_SOA != 0
+		for (size_t j = payload_start; j < payload_start + payload_count; j += payload_block_capacity)
+		{
+			const int lane = intersect8_nearest(
+				*get_payload_block(j),
+				get_payload_id(j),
+				payload_start + payload_count - j,
+				prior_target,
+				ray,
+				nearest_dist);
+
+			if (0 > lane)
+				continue;
+
+			m_hit->target = get_payload_id(j)[lane];
+			m_hit->dist = nearest_dist;
+		}
+
+#else
 		for (size_t j = payload_start; j < payload_start + payload_count; ++j)
 		{
 			const Voxel& voxel = m_payload.getElement(j);
@@ -1635,6 +2345,8 @@ Timeslice::traverse_lite(
 			}
 		}
 
+#endif
+
 		if (m_hit->target != prior_target)
 			return true;
 	}
@@ -1654,6 +2366,11 @@ Timeslice::traverse_litest(
 
 	const Ray& ray = *m_ray;
 
+#if AO_LOD != 0
+	++m_node_count;
+	const float child_extent = max_extent(bbox) * .5f;
+
+#endif
 	ChildIndex child_index;
 	BBox child_bbox[8] __attribute__ ((aligned(64))) =
 	{
@@ -1676,6 +2393,19 @@ Timeslice::traverse_litest(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if AO_LOD != 0
+		// far enough, an occupied child is deemed an occluder as a whole; the test is on the distance the ray enters the
+		// child at, so that children enclosing the ray origin are always kept at full detail
+		if (0.f != m_lod_slope && child_extent <= entry_distance(ray, child_bbox[child_index.index[i]]) * m_lod_slope)
+			return true;
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_interior.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1702,6 +2432,11 @@ Timeslice::traverse_litest< octree_level_last_but_one >(
 
 	const Ray& ray = *m_ray;
 
+#if AO_LOD != 0
+	++m_node_count;
+	const float child_extent = max_extent(bbox) * .5f;
+
+#endif
 	ChildIndex child_index;
 	BBox child_bbox[8] __attribute__ ((aligned(64))) =
 	{
@@ -1724,6 +2459,19 @@ Timeslice::traverse_litest< octree_level_last_but_one >(
 
 	for (size_t i = 0; i < hit_count; ++i)
 	{
+#if AO_LOD != 0
+		// far enough, an occupied child is deemed an occluder as a whole; the test is on the distance the ray enters the
+		// child at, so that children enclosing the ray origin are always kept at full detail
+		if (0.f != m_lod_slope && child_extent <= entry_distance(ray, child_bbox[child_index.index[i]]) * m_lod_slope)
+			return true;
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+		// fetch the records of the children due next, while this child is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch(&m_leaf.getElement(octet.get(child_index.index[j])));
+
+#endif
 		const size_t index = child_index.index[i];
 		const OctetId child_id = octet.get(index);
 
@@ -1750,6 +2498,10 @@ Timeslice::traverse_litest(
 
 	const Ray& ray = *m_ray;
 
+#if AO_LOD != 0
+	++m_node_count;
+
+#endif
 	ChildIndex child_index;
 
 	const size_t hit_count = octet_intersect_wide(
@@ -1767,6 +2519,25 @@ Timeslice::traverse_litest(
 
 		assert(0 != payload_count);
 
+#if TRAVERSE_PREFETCH != 0
+		// fetch the payload of the cells due next, while this cell is being traversed
+		for (size_t j = 0 == i ? 1 : i + TRAVERSE_PREFETCH; j <= i + TRAVERSE_PREFETCH && j < hit_count; ++j)
+			prefetch_payload(leaf, child_index.index[j]);
+
+#endif
+#if LEAF_PAYLOAD_SOA != 0
+		for (size_t j = payload_start; j < payload_start + payload_count; j += payload_block_capacity)
+			if (intersect8_any(
+					*get_payload_block(j),
+					get_payload_id(j),
+					payload_start + payload_count - j,
+					prior_target,
+					ray))
+			{
+				return true;
+			}
+
+#else
 		const size_t unroll_by_2 = payload_count & size_t(-2);
 
 		for (size_t j = payload_start; j < payload_start + unroll_by_2; j += 2)
@@ -1797,12 +2568,222 @@ Timeslice::traverse_litest(
 
 		if (id != prior_target && voxel.get_bbox().intersect(ray, dist))
 			return true;
+
+#endif
 	}
 
 	return false;
 }
 
 
+#if BEAM_PREPASS != 0
+template < unsigned OCTREE_LEVEL_T >
+inline bool
+Timeslice::traverse_from(
+	const BeamEntry& entry) const
+{
+	if (OCTREE_LEVEL_T == entry.level)
+		return traverse< OCTREE_LEVEL_T >(m_interior.getElement(entry.index), entry.bbox);
+
+	return traverse_from< OCTREE_LEVEL_T + 1 >(entry);
+}
+
+
+template <>
+inline bool
+Timeslice::traverse_from< octree_level_leaf >(
+	const BeamEntry& entry) const
+{
+	if (octree_level_leaf == entry.level)
+		return traverse(m_leaf.getElement(entry.index), entry.bbox);
+
+	return false;
+}
+
+
+inline void
+Timeslice::find_beam_entry(
+	const simd::vect3& apex,
+	const simd::vect3 (& edge)[4],
+	BeamEntry& entry) const
+{
+	assert(m_root_bbox.is_valid());
+
+	// bounding planes of the cone: the four sides, and the plane through the apex facing along the cone axis, which
+	// holds off whatever lies behind the apex as long as the cone is narrower than a half-space
+	const simd::vect3 axis = simd::vect3().add(
+		simd::vect3().add(edge[0], edge[1]),
+		simd::vect3().add(edge[2], edge[3]));
+
+	__m128 plane[5];
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		simd::vect3 side = simd::vect3().cross(edge[i], edge[(i + 1) % 4]);
+
+		if (side.dot(axis) < 0.f)
+			side.negate();
+
+		plane[i] = side.getn();
+	}
+
+	const bool narrow =
+		axis.dot(edge[0]) > 0.f &&
+		axis.dot(edge[1]) > 0.f &&
+		axis.dot(edge[2]) > 0.f &&
+		axis.dot(edge[3]) > 0.f;
+
+	plane[4] = narrow ? axis.getn() : _mm_setzero_ps();
+
+	entry.level = octree_level_count;
+
+	if (!cone_overlap(m_root_bbox, apex.getn(), plane))
+		return;
+
+	// descend as long as a single child can be hit by the bundle; child bboxes come out exactly as in the traversal
+	BBox bbox = m_root_bbox;
+	size_t index = 0;
+
+	for (unsigned level = octree_level_root; level < octree_level_leaf; ++level)
+	{
+		const Octet& octet = m_interior.getElement(index);
+		const __m128 par_min = bbox.get_min();
+		const __m128 par_max = bbox.get_max();
+		const __m128 par_mid = _mm_mul_ps(_mm_add_ps(par_min, par_max), _mm_set1_ps(.5f));
+
+		BBox child_bbox = BBox(BBox::flag_noinit());
+		size_t child_index = 0;
+		size_t child_count = 0;
+
+		for (size_t i = 0; i < 8; ++i)
+		{
+			if (octet.empty(i))
+				continue;
+
+			const __m128 upper = _mm_castsi128_ps(_mm_setr_epi32(i & 1 ? -1 : 0, i & 2 ? -1 : 0, i & 4 ? -1 : 0, 0));
+			const BBox child(
+				_mm_or_ps(_mm_and_ps(upper, par_mid), _mm_andnot_ps(upper, par_min)),
+				_mm_or_ps(_mm_and_ps(upper, par_max), _mm_andnot_ps(upper, par_mid)),
+				BBox::flag_direct());
+
+			if (!cone_overlap(child, apex.getn(), plane))
+				continue;
+
+			child_bbox = child;
+			child_index = octet.get(i);
+			++child_count;
+		}
+
+		if (0 == child_count)
+			return;
+
+		if (1 < child_count)
+		{
+			entry.bbox = bbox;
+			entry.level = level;
+			entry.index = uint32_t(index);
+			return;
+		}
+
+		bbox = child_bbox;
+		index = child_index;
+	}
+
+	entry.bbox = bbox;
+	entry.level = octree_level_leaf;
+	entry.index = uint32_t(index);
+}
+
+#endif
+#if AO_ANALYTIC != 0
+inline size_t
+Timeslice::gather(
+	const BBox& box,
+	PayloadId* const id,
+	const size_t capacity) const
+{
+	assert(m_root_bbox.is_valid());
+
+	if (!m_root_bbox.has_overlap_open(box))
+		return 0;
+
+	// depth-first over the nodes overlapping the box, the pending siblings of all levels kept on a stack; child bboxes
+	// come out exactly as in the traversal
+	struct Node
+	{
+		__m128 min;
+		__m128 max;
+		size_t level;
+		size_t index;
+	};
+
+	Node stack[octree_level_count * 7 + 1];
+	size_t depth = 0;
+	size_t count = 0;
+
+	const Node root = { m_root_bbox.get_min(), m_root_bbox.get_max(), octree_level_root, 0 };
+	stack[depth++] = root;
+
+	while (0 != depth)
+	{
+		const Node node = stack[--depth];
+		const __m128 par_mid = _mm_mul_ps(_mm_add_ps(node.min, node.max), _mm_set1_ps(.5f));
+
+		for (size_t i = 0; i < 8; ++i)
+		{
+			const __m128 upper = _mm_castsi128_ps(_mm_setr_epi32(i & 1 ? -1 : 0, i & 2 ? -1 : 0, i & 4 ? -1 : 0, 0));
+			const Node child = {
+				_mm_or_ps(_mm_and_ps(upper, par_mid), _mm_andnot_ps(upper, node.min)),
+				_mm_or_ps(_mm_and_ps(upper, node.max), _mm_andnot_ps(upper, par_mid)),
+				node.level + 1,
+				0
+			};
+
+			if (octree_level_leaf != node.level)
+			{
+				const Octet& octet = m_interior.getElement(node.index);
+
+				if (octet.empty(i) || !BBox(child.min, child.max, BBox::flag_direct()).has_overlap_open(box))
+					continue;
+
+				stack[depth] = child;
+				stack[depth++].index = octet.get(i);
+				continue;
+			}
+
+			const Leaf& leaf = m_leaf.getElement(node.index);
+
+			if (leaf.empty(i) || !BBox(child.min, child.max, BBox::flag_direct()).has_overlap_open(box))
+				continue;
+
+			// items span all cells they overlap, so skip those already gathered
+			const size_t payload_start = leaf.get_start(i);
+			const size_t payload_count = leaf.get_count(i);
+
+			for (size_t j = 0; j < payload_count; ++j)
+			{
+				const Voxel& voxel = m_payload.getElement(payload_start + j);
+
+				if (!voxel.get_bbox().has_overlap_open(box))
+					continue;
+
+				const PayloadId item = PayloadId(voxel.get_id());
+
+				if (id + count != std::find(id, id + count, item))
+					continue;
+
+				if (capacity == count)
+					return count;
+
+				id[count++] = item;
+			}
+		}
+	}
+
+	return count;
+}
+
+#endif
 #if CLANG_QUIRK_0001 == 0
 inline bool __attribute__ ((always_inline))
 Timeslice::traverse(
@@ -44,9 +44,11 @@ CFLAGS=(
 	-DWORKFORCE_NUM_THREADS=`lscpu | grep ^"CPU(s)" | sed s/^[^[:digit:]]*//`
 # Make workforce threads sticky (NUMA, etc)
 	-DWORKFORCE_THREADS_STICKY=`lscpu | grep ^"Socket(s)" | echo "\`sed s/^[^[:digit:]]*//\` > 1" | bc`
+# NUMA-aware workforce: per-node tree replicas, first-touch framebuffer, node-local tiles (needs sticky threads, 'division of labor' 3)
+#	-DWORKFORCE_NUMA=1
 # Colorize the output of individual threads
 #	-DCOLORIZE_THREADS=1
-# Threading model 'division of labor' alternatives: 0, 1, 2
+# Threading model 'division of labor' alternatives: 0, 1, 2, 3 (3: Morton-ordered tiles with work stealing)
 	-DDIVISION_OF_LABOR_VER=2
 # Number of AO rays per pixel
 	-DAO_NUM_RAYS=64
@@ -54,6 +56,44 @@ CFLAGS=(
 #	-DOUTDATED_MESA=1
 # Draw octree cells instead of octree content
 #	-DDRAW_TREE_CELLS=1
+# Draw a heatmap of the AO probes traced per pixel instead of AO; best combined with AO_ADAPTIVE
+#	-DDRAW_AO_PROBES=1
+# Store leaf payload also as SoA blocks of 8 voxels, for 8-wide voxel tests
+#	-DLEAF_PAYLOAD_SOA=1
+# Test the children of an octet with 16-lane ops in the avx512 render kernel (see RENDER_ISA below)
+#	-DINTERSECT16=1
+# Seed the primary traversal with the previous frame's hit at the pixel, pruning the tree past that hit
+#	-DHIT_PREDICTION=1
+# Prefetch the traversal data of the given number of children ahead in traversal order
+#	-DTRAVERSE_PREFETCH=1
+# Resolve primary visibility by rasterizing the scene's boxes instead of tracing primary rays
+#	-DPRIMARY_RASTER=1
+# Start primary traversal from per-tile entry points, found by a pre-pass of tile-sized ray bundles
+#	-DBEAM_PREPASS=1
+# Let AO probes take occupied tree nodes past a distance, set with -ao_lod, for occluders as a whole
+#	-DAO_LOD=1
+# Look AO probe directions up in per-face-orientation tables built at startup, rather than generate them
+#	-DAO_DIR_TABLE=1
+# Stop tracing AO probes at a pixel once its estimate converges, to the tolerance set with -ao_tolerance
+#	-DAO_ADAPTIVE=1
+# Accumulate AO over frames by reprojecting per-pixel history, tracing half the AO probes per frame over all pixels
+#	-DAO_TEMPORAL=1
+# Shade a phase of the pixels per frame, over the number of phases set with -interleave, and reconstruct the rest
+#	-DINTERLEAVE=1
+# Cache AO per texel of item faces, retagging items whose vicinity changed with each tree update
+#	-DAO_CACHE=1
+# Denoise AO on the CPU by an edge-aware a-trous filter guided by payload id, hit axis and hit distance; passes set with -denoise
+#	-DDENOISE=1
+# Trace a quarter of the AO probes per pixel, gathering the probes of each 2x2 pixel quad over its pixels of the same item face
+#	-DAO_QUAD=1
+# Compute AO in closed form from the boxes within the reach set with -ao_radius, rather than trace AO probes
+#	-DAO_ANALYTIC=1
+# Add cone-traced AO through an occupancy pyramid rebuilt with the tree, selected with -ao_mode next to probe-traced AO
+#	-DAO_CONE=1
+# Jitter the primary ray of each batch of 4 AO probes to its own subpixel position, antialiasing within the AO probe budget
+#	-DPRIMARY_JITTER=1
+# Use compact 2-byte framebuffer pixels -- AO intensity and pixel key -- for shading, display, DR and framegrabs
+#	-DCOMPACT_PIXEL=1
 # Clang static code analysis:
 #	--analyze
 # Compiler quirk 0001: control definition location of routines posing entry points to recursion for more efficient inlining
@@ -62,9 +102,10 @@ CFLAGS=(
 #	-DDR_CORE=2
 #	-DDR_SUPPLEMENT=2
 )
-# For non-native or tweaked architecture targets, comment out 'native' and uncomment the correct target architecture and flags
+# Architecture target of all code but the render kernels (see RENDER_ISA below), so keep it a baseline for the hosts of
+# choice; for tweaked architecture targets, comment out 'x86-64' and 'native' and uncomment the correct target and flags
 TARGET=(
-	native
+	x86-64
 	native
 # AMD Bobcat:
 #	btver1
@@ -87,6 +128,16 @@ TARGET=(
 #	core-avx-i
 #	core-avx-i
 )
+# Render kernel ISA levels, each built into the binary for runtime dispatch: the preferred level supported by the host
+# is used (see render_kernel in main.cpp), unless forced by the -isa option; comment out levels not supported by the
+# compiler of choice
+RENDER_ISA=(
+	sse2:"-msse2"
+	sse4_1:"-msse4.1"
+	avx:"-mavx"
+	avx2:"-mavx2 -mfma"
+	avx512:"-mavx512f -mavx512vl -mavx512dq -mavx512bw -mavx2 -mfma"
+)
 LFLAGS=(
 # Alias some glibc6 symbols to older ones for better portability
 #	-Wa,-defsym,memcpy=memcpy@GLIBC_2.2.5
@@ -122,6 +173,18 @@ else
 	)
 fi
 
-BUILD_CMD=$CC" -o "$BINARY" "${CFLAGS[@]}" -march="${TARGET[0]}" -mtune="${TARGET[@]:1}" "${SOURCE[@]}" "${LFLAGS[@]}
+RENDER_OBJ=()
+
+for entry in "${RENDER_ISA[@]}"; do
+	isa=${entry%%:*}
+	BUILD_CMD=$CC" -c -o "$BINARY"_render_"$isa".o "${CFLAGS[@]}" -fno-lto -march="${TARGET[0]}" -mtune="${TARGET[@]:1}" "${entry#*:}" -DRENDER_ISA="$isa" render.cpp"
+	echo $BUILD_CMD
+	CCC_ANALYZER_CPLUSPLUS=1 $BUILD_CMD || exit
+	CFLAGS+=(-DRENDER_ISA_`echo $isa | tr a-z A-Z`=1)
+	RENDER_OBJ+=($BINARY"_render_"$isa.o)
+done
+
+BUILD_CMD=$CC" -o "$BINARY" "${CFLAGS[@]}" -march="${TARGET[0]}" -mtune="${TARGET[@]:1}" "${SOURCE[@]}" "${RENDER_OBJ[@]}" "${LFLAGS[@]}
 echo $BUILD_CMD
 CCC_ANALYZER_CPLUSPLUS=1 $BUILD_CMD
+rm -f "${RENDER_OBJ[@]}"
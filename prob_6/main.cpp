@@ -14,17 +14,59 @@
 #error cannot be both a core and a supplement
 #endif
 
+#if (DR_CORE || DR_SUPPLEMENT) && AO_TEMPORAL != 0
+#error temporal AO requires shading all pixels every frame, unlike distributed rendering
+#endif
+
+#if (DR_CORE || DR_SUPPLEMENT || AO_TEMPORAL != 0) && INTERLEAVE != 0
+#error interleaved rendering is incompatible with distributed rendering and temporal AO
+#endif
+
+#if (DR_CORE || DR_SUPPLEMENT || INTERLEAVE != 0 || DRAW_TREE_CELLS != 0 || DRAW_AO_PROBES != 0) && DENOISE != 0
+#error denoising is incompatible with distributed rendering, interleaved rendering and debug views
+#endif
+
+#if (DR_CORE || DR_SUPPLEMENT || AO_TEMPORAL != 0 || INTERLEAVE != 0 || AO_CACHE != 0 || DENOISE != 0 || DRAW_TREE_CELLS != 0 || DRAW_AO_PROBES != 0) && AO_QUAD != 0
+#error quad AO is incompatible with distributed rendering, other AO reuse schemes and debug views
+#endif
+
+#if (AO_ADAPTIVE != 0 || AO_TEMPORAL != 0 || AO_CACHE != 0 || AO_QUAD != 0 || DRAW_AO_PROBES != 0) && AO_ANALYTIC != 0
+#error analytic AO traces no AO probes, leaving nothing to the probe sampling schemes
+#endif
+
+#if (AO_ANALYTIC != 0 || AO_CACHE != 0 || AO_QUAD != 0) && AO_CONE != 0
+#error cone-traced AO is incompatible with analytic AO and the AO reuse schemes keyed on probes
+#endif
+
+#if (COLORIZE_THREADS != 0 || DRAW_TREE_CELLS != 0 || DRAW_AO_PROBES != 0) && COMPACT_PIXEL != 0
+#error compact pixels hold a single intensity, leaving no room for the colors of debug views
+#endif
+
+#if (PRIMARY_RASTER != 0 || AO_DIR_TABLE != 0 || AO_ADAPTIVE != 0 || AO_TEMPORAL != 0 || AO_CACHE != 0 || DENOISE != 0 || AO_QUAD != 0 || AO_ANALYTIC != 0 || AO_CONE != 0 || DRAW_TREE_CELLS != 0 || DRAW_AO_PROBES != 0) && PRIMARY_JITTER != 0
+#error jittered primary rays take a primary hit per batch of AO probes, which only plain traced AO probes allow for
+#endif
+
+#if DR_SUPPLEMENT && DIVISION_OF_LABOR_VER == 3
+#error tiled division of labor does not cover the checkered framebuffer of a distributed-rendering supplement
+#endif
+
+#if WORKFORCE_NUMA == 1 && (WORKFORCE_THREADS_STICKY != 1 || DIVISION_OF_LABOR_VER != 3)
+#error NUMA awareness requires sticky workforce threads and the tiled division of labor
+#endif
+
 #include <png.h>
 #ifndef Z_BEST_COMPRESSION
 #define Z_BEST_COMPRESSION 9
 #endif
 
 #include "timer.h"
+#include "pure_macro.hpp"
 #include "sse_mathfun.h"
 #include "stream.hpp"
 #include "vectsimd_sse.hpp"
 #include "array.hpp"
 #include "problem_7.hpp"
+#include "render.hpp"
 
 #if DR_SUPPLEMENT == 0 && VISUALIZE != 0
 #include "native_gl.h"
@@ -36,6 +78,11 @@
 #include "util_eth.hpp"
 #endif
 
+#if WORKFORCE_NUMA == 1
+#include <stdio.h>
+#include <dirent.h>
+#endif
+
 // verify iostream-free status
 #if _GLIBCXX_IOSTREAM
 #error rogue iostream acquired
@@ -57,16 +104,37 @@ static const char arg_fsaa[]		= "fsaa";
 static const char arg_nframes[]		= "frames";
 static const char arg_iface[]		= "iface";
 static const char arg_peer[]		= "peer";
+static const char arg_isa[]			= "isa";
+static const char arg_ao_lod[]		= "ao_lod";
+static const char arg_ao_sampling[]	= "ao_sampling";
+static const char arg_ao_tolerance[]	= "ao_tolerance";
+static const char arg_interleave[]	= "interleave";
+static const char arg_denoise[]		= "denoise";
+static const char arg_ao_radius[]	= "ao_radius";
+static const char arg_ao_mode[]		= "ao_mode";
 
 static const size_t nthreads = WORKFORCE_NUM_THREADS;
 static const size_t one_less = nthreads - 1;
 static const size_t ao_probe_count = AO_NUM_RAYS;
 
-static const compile_assert< ao_probe_count % 4 == 0 > assert_ao_probe_count_even;
-
 enum
 {
 	BARRIER_START,
+#if WORKFORCE_NUMA == 1
+	BARRIER_REPLICA,
+#endif
+#if PRIMARY_RASTER != 0 || BEAM_PREPASS != 0
+	BARRIER_PREPASS,
+#endif
+#if INTERLEAVE != 0
+	BARRIER_RECONSTRUCT,
+#endif
+#if DENOISE != 0
+	BARRIER_DENOISE,
+#endif
+#if AO_QUAD != 0
+	BARRIER_QUAD,
+#endif
 	BARRIER_FINISH,
 	BARRIER_COUNT
 };
@@ -79,14 +147,15 @@ struct __attribute__ ((aligned(128))) compute_arg
 	uint32_t frame;
 
 	const Timeslice* tree;
+	const Voxel* content;
+	uint32_t content_count;
 
-	uint8_t (* framebuffer)[4];
+	render::Pixel* framebuffer;
+	render::Aux* auxbuffer;
 	uint16_t w;
 	uint16_t h;
 
-	uint32_t seed;
-
-	HitInfo hit;
+	prng::State rng;
 
 	simd::vect3 cam[4];
 
@@ -94,30 +163,39 @@ struct __attribute__ ((aligned(128))) compute_arg
 	: id(0)
 	, frame(0)
 	, tree(0)
+	, content(0)
+	, content_count(0)
 	, framebuffer(0)
+	, auxbuffer(0)
 	, w(0)
 	, h(0)
-	, seed(0)
 	{
+		prng::seed(rng, 0);
 	}
 
 	compute_arg(
 		const size_t arg_id,
-		uint8_t (* const arg_framebuffer)[4],
+		render::Pixel* const arg_framebuffer,
+		render::Aux* const arg_auxbuffer,
 		const unsigned arg_w,
 		const unsigned arg_h)
 	: id(arg_id)
 	, frame(0)
 	, tree(0)
+	, content(0)
+	, content_count(0)
 	, framebuffer(arg_framebuffer)
+	, auxbuffer(arg_auxbuffer)
 	, w(arg_w)
 	, h(arg_h)
+	{
 #if DR_SUPPLEMENT != 0
-	, seed(rand() + 47)
+		prng::seed(rng, rand() + 47);
+
 #else
-	, seed(rand())
+		prng::seed(rng, rand());
+
 #endif
-	{
 	}
 
 	compute_arg(
@@ -125,21 +203,28 @@ struct __attribute__ ((aligned(128))) compute_arg
 		const size_t arg_frame,
 		const simd::vect3 (& arg_cam)[4],
 		const Timeslice& arg_tree,
-		uint8_t (* const arg_framebuffer)[4],
+		const Array< Voxel >& arg_content,
+		render::Pixel* const arg_framebuffer,
+		render::Aux* const arg_auxbuffer,
 		const unsigned arg_w,
 		const unsigned arg_h)
 	: id(arg_id)
 	, frame(arg_frame)
 	, tree(&arg_tree)
+	, content(arg_content.getCount() ? &arg_content.getElement(0) : 0)
+	, content_count(arg_content.getCount())
 	, framebuffer(arg_framebuffer)
+	, auxbuffer(arg_auxbuffer)
 	, w(arg_w)
 	, h(arg_h)
+	{
 #if DR_SUPPLEMENT != 0
-	, seed(rand() + 47)
+		prng::seed(rng, rand() + 47);
+
 #else
-	, seed(rand())
+		prng::seed(rng, rand());
+
 #endif
-	{
 		cam[0] = arg_cam[0];
 		cam[1] = arg_cam[1];
 		cam[2] = arg_cam[2];
@@ -148,200 +233,902 @@ struct __attribute__ ((aligned(128))) compute_arg
 };
 
 
+static bool
+host_sse2()
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+
+static bool
+host_sse4_1()
+{
+	return __builtin_cpu_supports("sse4.1");
+}
+
+
+static bool
+host_avx()
+{
+	return __builtin_cpu_supports("avx");
+}
+
+
+static bool
+host_avx2()
+{
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+
+static bool
+host_avx512()
+{
+	return
+		__builtin_cpu_supports("avx512f") &&
+		__builtin_cpu_supports("avx512vl") &&
+		__builtin_cpu_supports("avx512dq") &&
+		__builtin_cpu_supports("avx512bw");
+}
+
+// render kernels built into this binary, in ascending order of preference, along with their host-support tests; avx512
+// ranks below avx2 as it measures slower on the demo scenes
+static const struct
+{
+	const render::Kernel& kernel;
+	bool (* const supported)();
+}
+render_kernel[] = {
+#if RENDER_ISA_SSE2 != 0
+	{ RENDER_KERNEL(sse2), host_sse2 },
+#endif
+#if RENDER_ISA_SSE4_1 != 0
+	{ RENDER_KERNEL(sse4_1), host_sse4_1 },
+#endif
+#if RENDER_ISA_AVX != 0
+	{ RENDER_KERNEL(avx), host_avx },
+#endif
+#if RENDER_ISA_AVX512 != 0
+	{ RENDER_KERNEL(avx512), host_avx512 },
+#endif
+#if RENDER_ISA_AVX2 != 0
+	{ RENDER_KERNEL(avx2), host_avx2 },
+#endif
+};
+
+static const compile_assert< 0 != COUNT_OF(render_kernel) > assert_render_kernel_count;
+
+// kernel of choice for the session
+static const render::Kernel* kernel;
+
+#if AO_LOD != 0
+// distance past which AO probes take occupied leaf nodes for occluders; zero for exact AO
+static float ao_lod;
+
+#endif
+#if AO_ADAPTIVE != 0
+// standard error of the AO visibility estimate at which a pixel stops tracing probes
+static float ao_tolerance;
+
+#endif
+#if AO_ANALYTIC != 0
+// reach of the analytic AO occluders about the hit
+static float ao_radius;
+
+#endif
+#if AO_CONE != 0
+// occupancy pyramid for cone-traced AO, spanning a cube about the tree's root bbox; rebuilt whenever the tree changes
+static float* cone_occupancy;
+static __m128 cone_origin;
+static float cone_scale;
+static bool cone_mode;                // shade AO by cones rather than probes
+static const Timeslice* cone_tree;    // tree last built for
+static uint32_t cone_version;         // version of that tree at the time
+static uint64_t cone_build_dt;        // time spent building the pyramid
+static unsigned cone_build_count;
+
+// build the occupancy pyramid of the given content, within the given root bbox: the finest level takes the volume of
+// each item's overlap with each cell, the coarser levels average their eight children
 static void
-shade(
-	const Timeslice& ts,
-	const Ray& ray,
-	HitInfo& hit,
-	unsigned& seed,
-	uint8_t (& pixel)[4])
+build_cone_pyramid(
+	const Array< Voxel >& content,
+	const BBox& root)
 {
-	hit.target = PayloadId(-1);
+	const int size = render::cone_grid_size;
+	const __m128 extent = _mm_sub_ps(root.get_max(), root.get_min());
+	const float side = std::max(extent[0], std::max(extent[1], extent[2]));
+
+	// center the root bbox in the cube, keeping the items off the sides of the cube along its shorter axes
+	cone_origin = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(root.get_min(), root.get_max()), _mm_set1_ps(.5f)), _mm_set1_ps(side * .5f));
+	cone_scale = size / side;
+
+	float* const grid = cone_occupancy;
+	memset(grid, 0, sizeof(float) * size * size * size);
 
-	if (!ts.traverse(ray, hit))
+	for (size_t i = 0; i < content.getCount(); ++i)
 	{
-		pixel[0] = 0;
-		pixel[1] = 0;
-		pixel[2] = 0;
-		pixel[3] = 0;
-		return;
+		const BBox& bbox = content.getElement(i).get_bbox();
+		const __m128 g0 = _mm_mul_ps(_mm_sub_ps(bbox.get_min(), cone_origin), _mm_set1_ps(cone_scale));
+		const __m128 g1 = _mm_mul_ps(_mm_sub_ps(bbox.get_max(), cone_origin), _mm_set1_ps(cone_scale));
+
+		int c0[3];
+		int c1[3];
+
+		for (size_t j = 0; j < 3; ++j)
+		{
+			c0[j] = std::max(int(g0[j]), 0);
+			c1[j] = std::min(int(ceilf(g1[j])), size);
+		}
+
+		for (int z = c0[2]; z < c1[2]; ++z)
+		{
+			const float cover_z = std::min(g1[2], z + 1.f) - std::max(g0[2], float(z));
+
+			for (int y = c0[1]; y < c1[1]; ++y)
+			{
+				const float cover_y = std::min(g1[1], y + 1.f) - std::max(g0[1], float(y));
+
+				for (int x = c0[0]; x < c1[0]; ++x)
+				{
+					const float cover_x = std::min(g1[0], x + 1.f) - std::max(g0[0], float(x));
+					float& cell = grid[(size_t(z) * size + y) * size + x];
+
+					cell = std::min(cell + cover_x * cover_y * cover_z, 1.f);
+				}
+			}
+		}
+	}
+
+	const float* src = grid;
+	float* dst = grid + size * size * size;
+
+	for (int n = size / 2; 0 != n; src = dst, dst += n * n * n, n /= 2)
+		for (int z = 0; z < n; ++z)
+			for (int y = 0; y < n; ++y)
+				for (int x = 0; x < n; ++x)
+				{
+					const size_t row = n * 2;
+					const size_t slice = row * row;
+					const float* const child = src + z * 2 * slice + y * 2 * row + x * 2;
+
+					dst[(size_t(z) * n + y) * n + x] = (
+						child[0] + child[1] + child[row] + child[row + 1] +
+						child[slice] + child[slice + 1] + child[slice + row] + child[slice + row + 1]) * .125f;
+				}
+}
+
+#endif
+#if AO_TEMPORAL != 0
+// AO history of the last two frames, used alternately, and the reprojection into the previous frame
+static render::History* history[2];
+static __m128 history_reproject[4];
+
+// history stands in for the pixels of the other checkerboard half, so all pixels get shaded every frame
+static const bool checkerboard = false;
+
+#else
+static const bool checkerboard = true;
+
+#endif
+#if AO_CACHE != 0
+// AO cache of item face texels, and the tags of the items it keys on; tags are retagged whenever the tree changes
+static render::AoCacheEntry* ao_cache;
+static Array< uint32_t > ao_cache_tag;     // per item of the content last retagged
+static Array< Voxel > ao_cache_content;    // content last retagged
+static const Timeslice* ao_cache_tree;     // tree last retagged for
+static uint32_t ao_cache_version;          // version of that tree at the time
+static uint32_t ao_cache_tag_last;         // last tag handed out
+
+// distance within which a change to the content stales the AO cached at other items; AO probes are unbounded, but
+// farther occluders subtend too little to matter
+static const float ao_cache_reach = 2.f;
+
+// tag the items of the given content anew, matching them by box to the items last retagged: an item keeps its tag if it
+// has a match, and no item without a match, on either side, is within reach of it; otherwise it gets a fresh tag, which
+// orphans its cache entries
+static bool
+retag_ao_cache(
+	const Array< Voxel >& content)
+{
+	const size_t count = content.getCount();
+	const size_t prev_count = ao_cache_content.getCount();
+
+	Array< uint32_t > match;   // per item, index of its match plus one, or zero for none
+	Array< bool > matched;     // per item last retagged
+	Array< BBox > changed;     // boxes of the items without a match, on either side
+	Array< uint32_t > tag;
+
+	if (!match.setCapacity(count) || !match.addMultiElement(count) ||
+		!matched.setCapacity(prev_count) || !matched.addMultiElement(prev_count) ||
+		!changed.setCapacity(count + prev_count) ||
+		!tag.setCapacity(count) || !tag.addMultiElement(count))
+	{
+		return false;
+	}
+
+	for (size_t j = 0; j < prev_count; ++j)
+		matched.getMutable(j) = false;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const BBox& bbox = content.getElement(i).get_bbox();
+		match.getMutable(i) = 0;
+
+		for (size_t j = 0; j < prev_count; ++j)
+		{
+			const BBox& prev = ao_cache_content.getElement(j).get_bbox();
+
+			if (matched.getElement(j) ||
+				7 != (7 & _mm_movemask_ps(_mm_cmpeq_ps(bbox.get_min(), prev.get_min()))) ||
+				7 != (7 & _mm_movemask_ps(_mm_cmpeq_ps(bbox.get_max(), prev.get_max()))))
+			{
+				continue;
+			}
+
+			match.getMutable(i) = j + 1;
+			matched.getMutable(j) = true;
+			break;
+		}
+
+		if (0 == match.getElement(i))
+			changed.addElement(bbox);
+	}
+
+	for (size_t j = 0; j < prev_count; ++j)
+		if (!matched.getElement(j))
+			changed.addElement(ao_cache_content.getElement(j).get_bbox());
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const BBox& bbox = content.getElement(i).get_bbox();
+		const BBox reach(
+			_mm_sub_ps(bbox.get_min(), _mm_set1_ps(ao_cache_reach)),
+			_mm_add_ps(bbox.get_max(), _mm_set1_ps(ao_cache_reach)), BBox::flag_direct());
+
+		bool stale = 0 == match.getElement(i);
+
+		for (size_t k = 0; k < changed.getCount() && !stale; ++k)
+			stale = reach.has_overlap_closed(changed.getElement(k));
+
+		tag.getMutable(i) = stale ? ++ao_cache_tag_last : ao_cache_tag.getElement(match.getElement(i) - 1);
+	}
+
+	ao_cache_content = content;
+	ao_cache_tag = tag;
+
+	return true;
+}
+
+#endif
+#if AO_QUAD != 0
+// quad AO: per pixel, probe sums of its quarter of its 2x2 quad's probes
+static render::QuadAo* quad_ao;
+
+#endif
+#if DENOISE != 0
+// AO denoiser: passes run per frame, the planes of its input and guides, and scratch planes to ping-pong passes between
+static unsigned denoise_passes;
+static float* denoise_visibility;
+static float* denoise_depth;
+static int32_t* denoise_key;
+static float* denoise_scratch[2];
+static unsigned denoise_pitch;
+
+#endif
+#if INTERLEAVE != 0
+// interleaved rendering: each frame shades one phase of the pixels, phases tiling the frame in square tiles, in an order
+// that keeps successive phases apart
+struct InterleavePattern
+{
+	unsigned phases;
+	unsigned tile;    // side of the square tile
+	uint8_t phase[9]; // phase of each tile pixel, row by row
+};
+
+static const InterleavePattern interleave_pattern[] = {
+	{ 1, 1, { 0 } },
+	{ 2, 2, { 0, 1,
+	          1, 0 } },
+	{ 4, 2, { 0, 2,
+	          3, 1 } },
+	{ 9, 3, { 0, 7, 3,
+	          6, 5, 2,
+	          4, 1, 8 } }
+};
+
+static const InterleavePattern* interleave;
+
+#endif
+// tell if pixel (x, y) is due for shading in the given frame
+static inline bool
+shade_due(
+	const unsigned x,
+	const unsigned y,
+	const size_t frame)
+{
+#if INTERLEAVE != 0
+	const unsigned tile = interleave->tile;
+	return interleave->phase[y % tile * tile + x % tile] == frame % interleave->phases;
+
+#else
+	return !checkerboard || (y ^ x) % 2 == frame % 2;
+
+#endif
+}
+
+#if INTERLEAVE != 0
+// fill in the pixels of rows [y0, y1) not shaded in the given frame, from the pixels shaded in it within a tile's reach;
+// a pixel holds its previous value if any of those shows the same item face (matching pixel key), otherwise it takes the
+// average of those showing the same item face as the nearest of them
+static void
+reconstruct(
+	render::Pixel* const framebuffer,
+	const unsigned w,
+	const unsigned h,
+	const unsigned y0,
+	const unsigned y1,
+	const size_t frame)
+{
+	const int reach = int(interleave->tile) - 1;
+
+	for (unsigned y = y0; y < y1; ++y)
+		for (unsigned x = 0; x < w; ++x)
+		{
+			if (shade_due(x, y, frame))
+				continue;
+
+			render::Pixel& pixel = framebuffer[y * w + x];
+			const unsigned nx0 = unsigned(std::max(int(x) - reach, 0));
+			const unsigned ny0 = unsigned(std::max(int(y) - reach, 0));
+			const unsigned nx1 = std::min(x + reach + 1, w);
+			const unsigned ny1 = std::min(y + reach + 1, h);
+
+			bool held = false;
+			unsigned nearest = 0;
+			unsigned nearest_dist = -1U;
+
+			for (unsigned ny = ny0; ny < ny1 && !held; ++ny)
+				for (unsigned nx = nx0; nx < nx1; ++nx)
+				{
+					if (!shade_due(nx, ny, frame))
+						continue;
+
+					if (framebuffer[ny * w + nx][render::pixel_key] == pixel[render::pixel_key])
+					{
+						held = true;
+						break;
+					}
+
+					const unsigned dist = (nx - x) * (nx - x) + (ny - y) * (ny - y);
+
+					if (dist < nearest_dist)
+					{
+						nearest_dist = dist;
+						nearest = ny * w + nx;
+					}
+				}
+
+			if (held || -1U == nearest_dist)
+				continue;
+
+			const uint8_t face = framebuffer[nearest][render::pixel_key];
+			unsigned sum[render::pixel_key] = { 0 };
+			unsigned count = 0;
+
+			for (unsigned ny = ny0; ny < ny1; ++ny)
+				for (unsigned nx = nx0; nx < nx1; ++nx)
+				{
+					if (!shade_due(nx, ny, frame) || framebuffer[ny * w + nx][render::pixel_key] != face)
+						continue;
+
+					for (size_t i = 0; i < render::pixel_key; ++i)
+						sum[i] += framebuffer[ny * w + nx][i];
+
+					++count;
+				}
+
+			for (size_t i = 0; i < render::pixel_key; ++i)
+				pixel[i] = uint8_t(sum[i] / count);
+
+			pixel[render::pixel_key] = face;
+		}
+}
+
+#endif
+#if AO_QUAD != 0
+// gather AO over the 2x2 quads of rows [y0, y1), y0 and y1 being even unless y1 is the frame height: each pixel shaded
+// in the given frame takes the AO of the probes of all quad pixels showing the same item face (matching pixel key) --
+// pixels not shaded in it contribute the probes of their last shading
+static void
+gather_quads(
+	render::Pixel* const framebuffer,
+	const render::QuadAo* const quad,
+	const unsigned w,
+	const unsigned h,
+	const unsigned y0,
+	const unsigned y1,
+	const size_t frame)
+{
+	for (unsigned y = y0; y < y1; ++y)
+		for (unsigned x = 0; x < w; ++x)
+		{
+			render::Pixel& pixel = framebuffer[y * w + x];
+
+			if (0 == pixel[render::pixel_key] || !shade_due(x, y, frame))
+				continue;
+
+			const unsigned qx0 = x & ~1U;
+			const unsigned qy0 = y & ~1U;
+			const unsigned qx1 = std::min(qx0 + 2, w);
+			const unsigned qy1 = std::min(qy0 + 2, h);
+
+			float lit = 0.f;
+			float all = 0.f;
+
+			for (unsigned qy = qy0; qy < qy1; ++qy)
+				for (unsigned qx = qx0; qx < qx1; ++qx)
+				{
+					if (framebuffer[qy * w + qx][render::pixel_key] != pixel[render::pixel_key])
+						continue;
+
+					lit += quad[qy * w + qx].lit;
+					all += quad[qy * w + qx].all;
+				}
+
+			const float intensity = sqrtf(lit / all);
+
+			render::set_intensity(pixel, uint8_t(255.f * intensity));
+		}
+}
+
+#endif
+// AO sample sequence and its per-pixel rotations, when not sampling randomly
+static uint32_t ao_sequence[ao_probe_count * 2] __attribute__ ((aligned(16)));
+static uint32_t ao_rotation[sampling::blue_noise_cells];
+static bool ao_sequenced;
+
+static const char* const ao_sampling_name[] = {
+	"random",
+	"r2",
+	"sobol"
+};
+
+static const compile_assert< COUNT_OF(ao_sampling_name) == sampling::strategy_count > assert_ao_sampling_name;
+
+#if AO_DIR_TABLE != 0
+// AO probe directions per face orientation, and their cosines to the face normal
+static render::ProbeDir probe_dir[render::probe_face_count][render::probe_dir_count];
+static float probe_cos[render::probe_dir_count] __attribute__ ((aligned(16)));
+
+static const compile_assert< ao_probe_count <= render::probe_dir_count > assert_probe_dir_count;
+
+// tabulate cosine-weighted hemispheres about each face normal from the R2 sequence, any window of which is well spread
+static void
+build_probe_dir()
+{
+	for (size_t i = 0; i < render::probe_dir_count; ++i)
+	{
+		uint32_t u[2];
+		sampling::r2(i, u);
+
+		const float r0 = (u[0] >> 8) * (1.f / (1 << 24));              // decl (cos^2)
+		const float r1 = (u[1] >> 8) * float(M_PI * 2 / (1 << 24)); // azim
+		const float sin_decl = sqrtf(1.f - r0);
+		const float cos_decl = sqrtf(r0);
+		const float sin_azim = sinf(r1);
+		const float cos_azim = cosf(r1);
+		const float hemi[3] = { cos_decl, cos_azim * sin_decl, sin_azim * sin_decl };
+
+		probe_cos[i] = cos_decl;
+
+		for (size_t face = 0; face < render::probe_face_count; ++face)
+		{
+			const size_t normal = face / 2;
+			float dir[4] = { 0.f, 0.f, 0.f, 0.f };
+
+			dir[normal] = face & 1 ? -hemi[0] : hemi[0];
+			dir[(normal + 1) % 3] = hemi[1];
+			dir[(normal + 2) % 3] = hemi[2];
+
+			// substitute max floats for infinities in the reciprocal direction, as Ray does
+			const __m128 d = _mm_loadu_ps(dir);
+			const __m128 rcp = _mm_div_ps(_mm_set1_ps(1.f), d);
+
+			probe_dir[face][i].dir = d;
+			probe_dir[face][i].rcpdir = _mm_max_ps(_mm_min_ps(rcp,
+				_mm_set1_ps( std::numeric_limits< float >::max())),
+				_mm_set1_ps(-std::numeric_limits< float >::max()));
+		}
+	}
+}
+
+#endif
+
+// get the most preferred kernel supported by the host, or the named kernel, if supported by the host; null on failure
+static const render::Kernel*
+select_kernel(
+	const char* const name)
+{
+	__builtin_cpu_init();
+
+	for (size_t i = COUNT_OF(render_kernel); i > 0; --i)
+		if ((0 == name || !strcmp(name, render_kernel[i - 1].kernel.name)) && render_kernel[i - 1].supported())
+			return &render_kernel[i - 1].kernel;
+
+	return 0;
+}
+
+
+// per-worker statistics
+static struct __attribute__ ((aligned(64))) // one per cacheline
+{
+	render::Stats s;
+	uint64_t shade_done; // time the worker ran out of pixels to shade this frame
+	uint64_t shade_idle; // time spent waiting on the last worker to run out of pixels, over all frames
+	uint64_t shade_busy; // time spent shading, over all frames
+
+#if DIVISION_OF_LABOR_VER == 3
+	uint64_t tiles;        // tiles shaded
+	uint64_t tiles_stolen; // tiles shaded off siblings' assignments
+
+#endif
+#if WORKFORCE_NUMA == 1
+	uint64_t tiles_remote; // tiles shaded off assignments of siblings on other nodes
+	uint64_t replicas;     // tree replicas refreshed
+
+#endif
+}
+stats[nthreads];
+
+#if PRIMARY_RASTER != 0
+// primary visibility by rasterization: item faces set up anew each frame, and the buffers they get rasterized into
+static const unsigned raster_tile_w = 64; // a multiple of 4
+static const unsigned raster_tile_h = 16;
+static render::RasterFace* raster_face;
+static float* raster_depth;
+static int32_t* raster_id;
+static unsigned raster_pitch;
+
+#endif
+#if BEAM_PREPASS != 0
+// tree entry points for the primary rays of each beam tile, found anew each frame
+static BeamEntry* beam_entry;
+
+#endif
+#if DIVISION_OF_LABOR_VER == 2
+static const unsigned batch = 32;
+static struct __attribute__ ((aligned(64))) // one per cacheline
+{
+	unsigned cursor;
+}
+worker[nthreads];
+
+#elif DIVISION_OF_LABOR_VER == 1
+static const unsigned batch = 32;
+static unsigned workgroup_cursor;
+
+#elif DIVISION_OF_LABOR_VER == 3
+static const unsigned tile_size = 16;
+static const uint32_t* tile_order; // tile coordinates in Morton order, row in the high half, column in the low half
+static struct __attribute__ ((aligned(64))) // one per cacheline
+{
+	uint64_t range; // unclaimed tiles of the worker's run in the tile order: begin in the low half, end in the high half
+	uint64_t run;   // the worker's run in the tile order, as a range; the range starts off as this every frame
+
+#if WORKFORCE_NUMA == 1
+	unsigned rows[2]; // framebuffer rows [y0, y1) the worker first-touches, out of its node's band
+
+#endif
+}
+worker[nthreads];
+
+// workers are grouped by NUMA node -- a single group unless NUMA-aware; each node renders its own band of tile rows
+static const unsigned numa_node_max = 8;
+static unsigned node_count = 1;
+static unsigned worker_node[nthreads]; // node of each worker
+
+#if WORKFORCE_NUMA == 1
+static unsigned node_lead[numa_node_max];            // first worker of each node, keeping the node's tree replica
+static Timeslice* tree_replica[numa_node_max];       // per-node copy of the tree, placed on the node by first touch
+static const Timeslice* replica_src[numa_node_max];  // tree last copied to each replica
+static uint32_t replica_version[numa_node_max];      // version of the tree last copied to each replica
+
+// get the NUMA node of the given CPU from sysfs, or node 0 if that is not known
+static unsigned
+node_of_cpu(
+	const size_t cpu)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", unsigned(cpu));
+
+	DIR* const dir = opendir(path);
+
+	if (0 == dir)
+		return 0;
+
+	unsigned node = 0;
+
+	while (const dirent* const entry = readdir(dir))
+		if (1 == sscanf(entry->d_name, "node%u", &node))
+			break;
+
+	closedir(dir);
+	return node;
+}
+
+#endif
+
+// claim a tile off the front of a worker's run if it is the claimant's own, or off the back if it is a sibling's;
+// return false if no tiles are left in the run
+static bool
+claim_tile(
+	const size_t owner,
+	const bool own,
+	unsigned& tile)
+{
+	uint64_t range = __atomic_load_n(&worker[owner].range, __ATOMIC_RELAXED);
+
+	while (true)
+	{
+		const uint32_t begin = uint32_t(range);
+		const uint32_t end = uint32_t(range >> 32);
+
+		if (begin >= end)
+			return false;
+
+		const uint64_t rest = own ? range + 1 : range - (uint64_t(1) << 32);
+
+		if (__atomic_compare_exchange_n(&worker[owner].range, &range, rest, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			tile = own ? begin : end - 1;
+			return true;
+		}
+	}
+}
+
+#endif
+
+static void*
+compute(
+	void* arg)
+{
+	compute_arg* const carg = reinterpret_cast< compute_arg* >(arg);
+	render::Pixel* const framebuffer = carg->framebuffer;
+	render::Aux* const auxbuffer = carg->auxbuffer;
+
+#if FB_RES_FIXED_W
+	const unsigned w = FB_RES_FIXED_W;
+
+#else
+	const unsigned w = carg->w;
+
+#endif
+#if FB_RES_FIXED_H
+	const unsigned h = FB_RES_FIXED_H;
+
+#else
+	const unsigned h = carg->h;
+
+#endif
+#if DR_SUPPLEMENT
+	const unsigned ww = w / DR_SUPPLEMENT;
+
+#endif
+	pthread_barrier_t* const barrier_start = barrier + BARRIER_START;
+	pthread_barrier_t* const barrier_finish = barrier + BARRIER_FINISH;
+#if WORKFORCE_NUMA == 1
+	pthread_barrier_t* const barrier_replica = barrier + BARRIER_REPLICA;
+#endif
+#if PRIMARY_RASTER != 0 || BEAM_PREPASS != 0
+	pthread_barrier_t* const barrier_prepass = barrier + BARRIER_PREPASS;
+#endif
+#if INTERLEAVE != 0
+	pthread_barrier_t* const barrier_reconstruct = barrier + BARRIER_RECONSTRUCT;
+#endif
+#if DENOISE != 0
+	pthread_barrier_t* const barrier_denoise = barrier + BARRIER_DENOISE;
+#endif
+#if AO_QUAD != 0
+	pthread_barrier_t* const barrier_quad = barrier + BARRIER_QUAD;
+#endif
+
+frame_loop:
+	pthread_barrier_wait(barrier_start);
+
+	const size_t id = carg->id;
+	const size_t frame = carg->frame;
+
+	if (uint32_t(-1) == uint32_t(id))
+		return 0;
+
+	render::Stats& st = stats[id].s;
+	render::Frame fr;
+
+	fr.tree = carg->tree;
+	fr.content = carg->content;
+	fr.content_count = carg->content_count;
+	fr.cam[0] = carg->cam[0].getn();
+	fr.cam[1] = carg->cam[1].getn();
+	fr.cam[2] = carg->cam[2].getn();
+	fr.cam[3] = carg->cam[3].getn();
+	fr.w = w;
+	fr.h = h;
+
+#if WORKFORCE_NUMA == 1
+	// the first worker of each node refreshes the node's replica of the tree whenever that is out of date; on the first
+	// frame, each worker also clears its rows of the framebuffer, placing their pages on its node
+	const unsigned node = worker_node[id];
+
+	if (node_lead[node] == id && (replica_src[node] != carg->tree || replica_version[node] != carg->tree->get_version()))
+	{
+		carg->tree->replicate(*tree_replica[node]);
+		replica_src[node] = carg->tree;
+		replica_version[node] = carg->tree->get_version();
+		stats[id].replicas += 1;
 	}
 
-#if DRAW_TREE_CELLS == 1
-	const uint8_t color_r[8] = { 255, 127,  63,  63,   0,   0,   0,   0 };
-	const uint8_t color_g[8] = {   0,  63, 127, 255, 255, 127,  63,   0 };
-	const uint8_t color_b[8] = {   0,   0,   0,   0,  63,  63, 127, 255 };
+	if (0 == frame)
+	{
+		const unsigned y0 = worker[id].rows[0];
+		const unsigned y1 = worker[id].rows[1];
+
+		memset(framebuffer + y0 * w, 0, (y1 - y0) * w * sizeof(render::Pixel));
+		memset(auxbuffer + y0 * w, 0xff, (y1 - y0) * w * sizeof(render::Aux));
+	}
+
+	pthread_barrier_wait(barrier_replica);
+	fr.tree = tree_replica[node];
+
+#endif
+#if AO_LOD != 0
+	fr.ao_lod = ao_lod;
+
+#else
+	fr.ao_lod = 0.f;
+
+#endif
+#if AO_ADAPTIVE != 0
+	fr.ao_tolerance = ao_tolerance;
+
+#else
+	fr.ao_tolerance = 0.f;
+
+#endif
+#if AO_ANALYTIC != 0
+	fr.ao_radius = ao_radius;
+
+#else
+	fr.ao_radius = 0.f;
+
+#endif
+	fr.ao_sequence = ao_sequenced ? ao_sequence : 0;
+	fr.ao_rotation = &ao_rotation;
+
+#if AO_TEMPORAL != 0
+	// rotate the AO sample sequence of all pixels along the R2 sequence, so that frames sample anew
+	sampling::r2(uint32_t(frame), fr.ao_shift);
+
+	fr.history_prev = history[~frame & 1];
+	fr.history = history[frame & 1];
+	fr.reproject[0] = history_reproject[0];
+	fr.reproject[1] = history_reproject[1];
+	fr.reproject[2] = history_reproject[2];
+	fr.reproject[3] = history_reproject[3];
 
-	assert(8 > hit.target);
+#else
+	fr.ao_shift[0] = 0;
+	fr.ao_shift[1] = 0;
+	fr.history_prev = 0;
+	fr.history = 0;
+
+#endif
+#if AO_CACHE != 0
+	fr.ao_cache = ao_cache;
+	fr.ao_cache_tag = ao_cache_tag.getCount() ? &ao_cache_tag.getElement(0) : 0;
+
+#else
+	fr.ao_cache = 0;
+	fr.ao_cache_tag = 0;
+
+#endif
+#if DENOISE != 0
+	fr.denoise_visibility = denoise_visibility;
+	fr.denoise_depth = denoise_depth;
+	fr.denoise_key = denoise_key;
+	fr.denoise_pitch = denoise_pitch;
+
+#else
+	fr.denoise_visibility = 0;
+	fr.denoise_depth = 0;
+	fr.denoise_key = 0;
+	fr.denoise_pitch = 0;
+
+#endif
+#if AO_QUAD != 0
+	fr.quad = quad_ao;
 
-	pixel[0] = color_r[hit.target];
-	pixel[1] = color_g[hit.target];
-	pixel[2] = color_b[hit.target];
-	return;
+#else
+	fr.quad = 0;
 
 #endif
-	// decode plane hit - reconstruct its axis and sign
-	const __m128 axis_sign = _mm_and_ps(_mm_set1_ps(-0.f), hit.min_mask);
+#if AO_CONE != 0
+	fr.cone_occupancy = cone_mode ? cone_occupancy : 0;
+	fr.cone_origin = cone_origin;
+	fr.cone_scale = cone_scale;
 
-#if __AVX__
-	const int xyz = 0x020100; // x-axis: 0 1 2
-	const int zxy = 0x010002; // y-axis: 2 0 1
-	const int yzx = 0x000201; // z-axis: 1 2 0
+#else
+	fr.cone_occupancy = 0;
+	fr.cone_origin = _mm_setzero_ps();
+	fr.cone_scale = 0.f;
 
-	const size_t axis = (xyz & hit.a_mask | zxy & ~hit.a_mask) & hit.b_mask | yzx & ~hit.b_mask;
-	const __m128i perm = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(axis));
+#endif
 
-#else
-	const int axis_x = 0;
-	const int axis_y = 1;
-	const int axis_z = 2;
-
-	const size_t axis = (axis_x & hit.a_mask | axis_y & ~hit.a_mask) & hit.b_mask | axis_z & ~hit.b_mask;
-
-#endif
-	const simd::vect3 orig = simd::vect3().add(
-		ray.get_origin(), simd::vect3().mul(ray.get_direction(), hit.dist));
-
-	__m128 lit = _mm_set1_ps(0.f);
-	__m128 all = _mm_set1_ps(0.f);
-
-	// manually unroll the AO shading loop by 4
-	for (size_t i = 0; i < ao_probe_count / 4; ++i)
-	{
-		const compile_assert< 0 == (RAND_MAX & RAND_MAX + 1L) > assert_rand_pot;
-		const int rnd0 = rand_r(&seed);
-		const int rnd1 = rand_r(&seed);
-		const int rnd2 = rand_r(&seed);
-		const int rnd3 = rand_r(&seed);
-		const int rnd4 = rand_r(&seed);
-		const int rnd5 = rand_r(&seed);
-		const int rnd6 = rand_r(&seed);
-		const int rnd7 = rand_r(&seed);
-		const __m128i ri0 = _mm_setr_epi32(rnd0, rnd1, rnd2, rnd3);
-		const __m128i ri1 = _mm_setr_epi32(rnd4, rnd5, rnd6, rnd7);
-
-		// cosine-weighted distribution
-		const __m128 r0 = _mm_mul_ps(_mm_cvtepi32_ps(ri0), _mm_setr_ps(
-			1.0 / RAND_MAX,   // decl0 (cos^2)
-			1.0 / RAND_MAX,   // decl1 (cos^2)
-			1.0 / RAND_MAX,   // decl2 (cos^2)
-			1.0 / RAND_MAX)); // decl3 (cos^2)
-		const __m128 r1 = _mm_mul_ps(_mm_cvtepi32_ps(ri1), _mm_setr_ps(
-			M_PI * 2 / (RAND_MAX + 1L),   // azim0
-			M_PI * 2 / (RAND_MAX + 1L),   // azim1
-			M_PI * 2 / (RAND_MAX + 1L),   // azim2
-			M_PI * 2 / (RAND_MAX + 1L))); // azim3
-		const __m128 sin_decl = _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.f), r0));
-		const __m128 cos_decl = _mm_sqrt_ps(r0);
-		all = _mm_add_ps(all, cos_decl);
-		__m128 sin_azim;
-		__m128 cos_azim;
-		sincos_ps(r1, &sin_azim, &cos_azim);
-
-		// compute a bounce vector in some TBN space, in this case of an assumed normal along x-axis
-		simd::vect3 hemi0 = simd::vect3(cos_decl[0], cos_azim[0] * sin_decl[0], sin_azim[0] * sin_decl[0], true);
-		simd::vect3 hemi1 = simd::vect3(cos_decl[1], cos_azim[1] * sin_decl[1], sin_azim[1] * sin_decl[1], true);
-		simd::vect3 hemi2 = simd::vect3(cos_decl[2], cos_azim[2] * sin_decl[2], sin_azim[2] * sin_decl[2], true);
-		simd::vect3 hemi3 = simd::vect3(cos_decl[3], cos_azim[3] * sin_decl[3], sin_azim[3] * sin_decl[3], true);
-
-#if __AVX__
-		// permute bounce direction depending on which axial plane was hit
-		const __m128 pdir0 = _mm_permutevar_ps(hemi0.getn(), perm);
-		const __m128 pdir1 = _mm_permutevar_ps(hemi1.getn(), perm);
-		const __m128 pdir2 = _mm_permutevar_ps(hemi2.getn(), perm);
-		const __m128 pdir3 = _mm_permutevar_ps(hemi3.getn(), perm);
-
-		simd::vect3 probe_dir0;
-		simd::vect3 probe_dir1;
-		simd::vect3 probe_dir2;
-		simd::vect3 probe_dir3;
+#if AO_DIR_TABLE != 0
+	fr.probe_dir = probe_dir;
+	fr.probe_cos = probe_cos;
 
 #else
-#error unsupported ISA for this block
+	fr.probe_dir = 0;
+	fr.probe_cos = 0;
 
 #endif
-		probe_dir0.setn(0, _mm_xor_ps(pdir0, axis_sign));
-		probe_dir1.setn(0, _mm_xor_ps(pdir1, axis_sign));
-		probe_dir2.setn(0, _mm_xor_ps(pdir2, axis_sign));
-		probe_dir3.setn(0, _mm_xor_ps(pdir3, axis_sign));
 
-		const Ray probe0(orig, probe_dir0);
-		const Ray probe1(orig, probe_dir1);
-		const Ray probe2(orig, probe_dir2);
-		const Ray probe3(orig, probe_dir3);
+#if PRIMARY_RASTER != 0
+	fr.raster_depth = raster_depth;
+	fr.raster_id = raster_id;
+	fr.raster_pitch = raster_pitch;
 
-		const __m128i shadow_hit = _mm_setr_epi32(
-			ts.traverse_litest(probe0, hit) ? 0 : -1,
-			ts.traverse_litest(probe1, hit) ? 0 : -1,
-			ts.traverse_litest(probe2, hit) ? 0 : -1,
-			ts.traverse_litest(probe3, hit) ? 0 : -1);
-		lit = _mm_add_ps(lit, _mm_and_ps(cos_decl, _mm_castsi128_ps(shadow_hit)));
-	}
-
-	const float intensity = sqrtf((lit[0] + lit[1] + lit[2] + lit[3]) / (all[0] + all[1] + all[2] + all[3]));
+	// primary visibility: set up the faces of this worker's share of the content, then, once all faces are set up,
+	// rasterize them over this worker's share of the frame tiles
+	kernel->raster_setup(fr, fr.content_count * id / nthreads, fr.content_count * (id + 1) / nthreads, raster_face);
 
-	pixel[0] = uint8_t(255.f * intensity);
-	pixel[1] = uint8_t(255.f * intensity);
-	pixel[2] = uint8_t(255.f * intensity);
+	pthread_barrier_wait(barrier_prepass);
 
-	// truncate payload id to 6 LSBs when storing it in the pixel
-	pixel[3] = size_t(hit.target) << 2 | (axis & 3) + 1;
-}
+	const unsigned raster_tiles_x = (w + raster_tile_w - 1) / raster_tile_w;
+	const unsigned raster_tiles_y = (h + raster_tile_h - 1) / raster_tile_h;
 
+	for (unsigned i = id; i < raster_tiles_x * raster_tiles_y; i += nthreads)
+	{
+		const unsigned x0 = i % raster_tiles_x * raster_tile_w;
+		const unsigned y0 = i / raster_tiles_x * raster_tile_h;
 
-#if DIVISION_OF_LABOR_VER == 2
-static const unsigned batch = 32;
-static struct __attribute__ ((aligned(64))) // one per cacheline
-{
-	unsigned cursor;
-}
-worker[nthreads];
+		kernel->raster(fr, raster_face, fr.content_count * render::raster_faces_per_item,
+			x0, y0, std::min(x0 + raster_tile_w, w), std::min(y0 + raster_tile_h, h));
+	}
 
-#elif DIVISION_OF_LABOR_VER == 1
-static const unsigned batch = 32;
-static unsigned workgroup_cursor;
+#else
+	fr.raster_depth = 0;
+	fr.raster_id = 0;
+	fr.raster_pitch = 0;
 
 #endif
+#if BEAM_PREPASS != 0
+	// find the tree entry points of this worker's share of the beam tiles
+	const unsigned beam_tiles_x = (w + render::beam_tile_size - 1) / render::beam_tile_size;
+	const unsigned beam_tiles_y = (h + render::beam_tile_size - 1) / render::beam_tile_size;
 
-static void*
-compute(
-	void* arg)
-{
-	compute_arg* const carg = reinterpret_cast< compute_arg* >(arg);
-	uint8_t (* const framebuffer)[4] = carg->framebuffer;
-
-#if FB_RES_FIXED_W
-	const unsigned w = FB_RES_FIXED_W;
+	for (unsigned i = id; i < beam_tiles_x * beam_tiles_y; i += nthreads)
+	{
+		const unsigned x0 = i % beam_tiles_x * render::beam_tile_size;
+		const unsigned y0 = i / beam_tiles_x * render::beam_tile_size;
 
-#else
-	const unsigned w = carg->w;
+		kernel->beam(fr, x0, y0, std::min(x0 + render::beam_tile_size, w), std::min(y0 + render::beam_tile_size, h),
+			beam_entry[i], st);
+	}
 
-#endif
-#if FB_RES_FIXED_H
-	const unsigned h = FB_RES_FIXED_H;
+	fr.beam = beam_entry;
+	fr.beam_tiles_x = beam_tiles_x;
 
 #else
-	const unsigned h = carg->h;
+	fr.beam = 0;
+	fr.beam_tiles_x = 0;
 
 #endif
-#if DR_SUPPLEMENT
-	const unsigned ww = w / DR_SUPPLEMENT;
+#if PRIMARY_RASTER != 0 || BEAM_PREPASS != 0
+	pthread_barrier_wait(barrier_prepass);
 
 #endif
-	pthread_barrier_t* const barrier_start = barrier + BARRIER_START;
-	pthread_barrier_t* const barrier_finish = barrier + BARRIER_FINISH;
-
-frame_loop:
-	pthread_barrier_wait(barrier_start);
-
-	const size_t id = carg->id;
-	const size_t frame = carg->frame;
-
-	if (uint32_t(-1) == uint32_t(id))
-		return 0;
-
-	const Timeslice* const ts = carg->tree;
-	const simd::vect3 (& cam)[4] = carg->cam;
+	const uint64_t shade_start = timer_ns();
 
 #if DIVISION_OF_LABOR_VER == 2
 	// enhanced dynamic division of labor: each worker finishes its pre-assigned portion, then claims the next batch of work
@@ -379,21 +1166,15 @@ frame_loop:
 				const unsigned y = linear / w;
 				const unsigned x = linear % w;
 
-				if ((y ^ x) % 2 != frame % 2)
+				if (!shade_due(x, y, frame))
 					continue;
 
 #endif
-				const simd::vect3 offs = simd::vect3().add(
-					simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
-					simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
-
-				const Ray ray(cam[3], simd::vect3().add(cam[2], offs));
-
 #if DR_SUPPLEMENT
-				shade(*ts, ray, carg->hit, carg->seed, framebuffer[linear / 2]);
+				kernel->shade(fr, x, y, carg->rng, framebuffer[linear / 2], auxbuffer[linear / 2], st);
 
 #else
-				shade(*ts, ray, carg->hit, carg->seed, framebuffer[linear]);
+				kernel->shade(fr, x, y, carg->rng, framebuffer[linear], auxbuffer[linear], st);
 
 #endif
 #if COLORIZE_THREADS == 1
@@ -421,19 +1202,69 @@ frame_loop:
 			const unsigned y = ci / w;
 			const unsigned x = ci % w;
 
-			if ((y ^ x) % 2 != frame % 2)
+			if (!shade_due(x, y, frame))
 				continue;
 
-			const simd::vect3 offs = simd::vect3().add(
-				simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
-				simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
+			kernel->shade(fr, x, y, carg->rng, framebuffer[y * w + x], auxbuffer[y * w + x], st);
+
+#if COLORIZE_THREADS == 1
+			framebuffer[y * w + x][id % 4] += 32;
+
+#endif
+		}
+	}
+
+#elif DIVISION_OF_LABOR_VER == 3
+	// work-stealing division of labor: the frame is cut into square tiles, ordered along a Morton curve so that tiles close
+	// in the order are close on screen, and each worker is pre-assigned a contiguous run of that order; a worker claims
+	// its own tiles from the front of its run, then steals from the backs of siblings' runs, away from where they work;
+	// NUMA-aware workers steal from siblings on their own node first, and cross nodes only to even out the tail
+
+#if WORKFORCE_NUMA == 1
+	const size_t steal_passes = 2;
+
+#else
+	const size_t steal_passes = 1;
+
+#endif
+	for (size_t j = 0; j < steal_passes * nthreads; ++j)
+	{
+		const size_t i = j % nthreads;
+		const size_t effective_id = (id + i) % nthreads;
+
+		if ((worker_node[effective_id] == worker_node[id]) != (j < nthreads))
+			continue;
+
+		unsigned tile;
+
+		while (claim_tile(effective_id, 0 == j, tile))
+		{
+			const unsigned x0 = (tile_order[tile] & 0xffff) * tile_size;
+			const unsigned y0 = (tile_order[tile] >> 16) * tile_size;
+			const unsigned x1 = std::min(x0 + tile_size, w);
+			const unsigned y1 = std::min(y0 + tile_size, h);
 
-			const Ray ray(cam[3], simd::vect3().add(cam[2], offs));
+			for (unsigned y = y0; y < y1; ++y)
+			{
+				for (unsigned x = x0; x < x1; ++x)
+				{
+					if (!shade_due(x, y, frame))
+						continue;
 
-			shade(*ts, ray, carg->hit, carg->seed, framebuffer[y * w + x]);
+					kernel->shade(fr, x, y, carg->rng, framebuffer[y * w + x], auxbuffer[y * w + x], st);
 
 #if COLORIZE_THREADS == 1
-			framebuffer[y * w + x][id % 4] += 32;
+					framebuffer[y * w + x][id % 4] += 32;
+
+#endif
+				}
+			}
+
+			stats[id].tiles += 1;
+			stats[id].tiles_stolen += 0 != j;
+
+#if WORKFORCE_NUMA == 1
+			stats[id].tiles_remote += j >= nthreads;
 
 #endif
 		}
@@ -447,19 +1278,13 @@ frame_loop:
 	{
 		for (unsigned x = 0; x < w; ++x)
 		{
-			if ((y ^ x) % 2 != frame % 2)
+			if (!shade_due(x, y, frame))
 				continue;
 
 			if ((y ^ x) / 2 % nthreads != id)
 				continue;
 
-			const simd::vect3 offs = simd::vect3().add(
-				simd::vect3(cam[1]).mul((int(y) * 2 - int(h)) * (1.f / h)),
-				simd::vect3(cam[0]).mul((int(x) * 2 - int(w)) * (1.f / w)));
-
-			const Ray ray(cam[3], simd::vect3().add(cam[2], offs));
-
-			shade(*ts, ray, carg->hit, carg->seed, framebuffer[y * w + x]);
+			kernel->shade(fr, x, y, carg->rng, framebuffer[y * w + x], auxbuffer[y * w + x], st);
 
 #if COLORIZE_THREADS == 1
 			framebuffer[y * w + x][id % 4] += 32;
@@ -469,7 +1294,39 @@ frame_loop:
 	}
 
 #endif
+	kernel->flush_stats(st);
+	stats[id].shade_done = timer_ns();
+	stats[id].shade_busy += stats[id].shade_done - shade_start;
+
+#if INTERLEAVE != 0
+	// once all due pixels are in, reconstruct the rest, each worker over its own band of rows
+	if (1 < interleave->phases)
+	{
+		pthread_barrier_wait(barrier_reconstruct);
+		reconstruct(framebuffer, w, h, unsigned(h * id / nthreads), unsigned(h * (id + 1) / nthreads), frame);
+	}
+
+#endif
+#if DENOISE != 0
+	// once all pixels are in, denoise AO in passes of growing tap step, each worker over its own band of rows; the input
+	// plane is left intact, as pixels not shaded next frame carry on from it
+	for (size_t i = 0; i < denoise_passes; ++i)
+	{
+		pthread_barrier_wait(barrier_denoise);
+
+		const float* const src = 0 == i ? denoise_visibility : denoise_scratch[~i & 1];
+		float* const dst = denoise_passes == i + 1 ? 0 : denoise_scratch[i & 1];
+
+		kernel->denoise(fr, src, dst, 1U << i, unsigned(h * id / nthreads), unsigned(h * (id + 1) / nthreads), framebuffer);
+	}
 
+#endif
+#if AO_QUAD != 0
+	// once all pixels are in, gather AO over quads, each worker over its own band of quad rows
+	pthread_barrier_wait(barrier_quad);
+	gather_quads(framebuffer, quad_ao, w, h, unsigned(h * id / nthreads) & ~1U, id + 1 == nthreads ? h : unsigned(h * (id + 1) / nthreads) & ~1U, frame);
+
+#endif
 	pthread_barrier_wait(barrier_finish);
 
 	if (0 != id)
@@ -493,7 +1350,8 @@ class workforce_t
 
 public:
 	workforce_t(
-		uint8_t (* const framebuffer)[4],
+		render::Pixel* const framebuffer,
+		render::Aux* const auxbuffer,
 		const unsigned w,
 		const unsigned h);
 
@@ -504,7 +1362,8 @@ public:
 	void update(
 		const size_t frame,
 		const simd::vect3 (& cam)[4],
-		const Timeslice& tree);
+		const Timeslice& tree,
+		const Array< Voxel >& content);
 };
 
 
@@ -520,7 +1379,8 @@ report_err(
 
 
 workforce_t::workforce_t(
-	uint8_t (* const framebuffer)[4],
+	render::Pixel* const framebuffer,
+	render::Aux* const auxbuffer,
 	const unsigned w,
 	const unsigned h)
 : barriers_created(0)
@@ -540,10 +1400,25 @@ workforce_t::workforce_t(
 		++barriers_created;
 	}
 
+#if WORKFORCE_NUMA == 1
+	// pin the main thread too, as it doubles as worker 0
+	cpu_set_t affin;
+	CPU_ZERO(&affin);
+	CPU_SET(0, &affin);
+
+	const int ra = pthread_setaffinity_np(pthread_self(), sizeof(affin), &affin);
+
+	if (0 != ra)
+	{
+		report_err(__FUNCTION__, __LINE__, 0, ra);
+		return;
+	}
+
+#endif
 	for (size_t i = 0; i < COUNT_OF(record); ++i)
 	{
 		const size_t id = i + 1;
-		record[i] = compute_arg(id, framebuffer, w, h);
+		record[i] = compute_arg(id, framebuffer, auxbuffer, w, h);
 
 #if WORKFORCE_THREADS_STICKY == 1
 		struct scoped_t
@@ -646,12 +1521,15 @@ void
 workforce_t::update(
 	const size_t frame,
 	const simd::vect3 (& cam)[4],
-	const Timeslice& tree)
+	const Timeslice& tree,
+	const Array< Voxel >& content)
 {
 	for (size_t i = 0; i < COUNT_OF(record); ++i)
 	{
 		record[i].frame = frame;
 		record[i].tree = &tree;
+		record[i].content = content.getCount() ? &content.getElement(0) : 0;
+		record[i].content_count = content.getCount();
 		record[i].cam[0] = cam[0];
 		record[i].cam[1] = cam[1];
 		record[i].cam[2] = cam[2];
@@ -684,6 +1562,68 @@ validate_fullscreen(
 }
 
 
+static bool
+validate_ao_sampling(
+	const char* const string,
+	unsigned& strategy)
+{
+	for (size_t i = 0; i < COUNT_OF(ao_sampling_name); ++i)
+		if (!strcmp(string, ao_sampling_name[i]))
+		{
+			strategy = i;
+			return true;
+		}
+
+	return false;
+}
+
+
+#if AO_CONE != 0
+static bool
+validate_ao_mode(
+	const char* const string,
+	unsigned& mode)
+{
+	static const char* const ao_mode_name[] = {
+		"probes",
+		"cones"
+	};
+
+	for (size_t i = 0; i < COUNT_OF(ao_mode_name); ++i)
+		if (!strcmp(string, ao_mode_name[i]))
+		{
+			mode = i;
+			return true;
+		}
+
+	return false;
+}
+
+
+#endif
+#if INTERLEAVE != 0
+static bool
+validate_interleave(
+	const char* const string,
+	unsigned& phases)
+{
+	unsigned candidate;
+
+	if (1 != sscanf(string, "%u", &candidate))
+		return false;
+
+	for (size_t i = 0; i < COUNT_OF(interleave_pattern); ++i)
+		if (interleave_pattern[i].phases == candidate)
+		{
+			phases = candidate;
+			return true;
+		}
+
+	return false;
+}
+
+#endif
+
 static bool
 validate_bitness(
 	const char* const string,
@@ -781,6 +1721,14 @@ struct Param {
 	uint64_t peer_mac;      // MAC of DR peer
 	const char* iface_name; // name of LAN iface
 	unsigned iface_namelen; // length of iface name
+	const char* isa_name;   // name of render kernel ISA level
+	float ao_lod;           // AO level-of-detail distance
+	unsigned ao_sampling;   // AO sampling strategy
+	float ao_tolerance;     // AO adaptive sampling tolerance
+	unsigned interleave;    // interleaved rendering phases
+	unsigned denoise;       // AO denoiser passes
+	float ao_radius;        // analytic AO occluder reach
+	unsigned ao_mode;       // AO shading mode
 };
 
 static int
@@ -834,6 +1782,85 @@ parse_cli(
 			continue;
 		}
 
+		if (!strcmp(argv[i] + prefix_len, arg_isa))
+		{
+			if (!(++i < argc))
+				success = false;
+			else
+				param.isa_name = argv[i];
+
+			continue;
+		}
+
+		if (!strcmp(argv[i] + prefix_len, arg_ao_sampling))
+		{
+			if (!(++i < argc) || !validate_ao_sampling(argv[i], param.ao_sampling))
+				success = false;
+
+			continue;
+		}
+
+#if AO_ADAPTIVE != 0
+		if (!strcmp(argv[i] + prefix_len, arg_ao_tolerance))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%f", &param.ao_tolerance)) || 0.f > param.ao_tolerance)
+				success = false;
+
+			continue;
+		}
+
+#endif
+#if AO_CONE != 0
+		if (!strcmp(argv[i] + prefix_len, arg_ao_mode))
+		{
+			if (!(++i < argc) || !validate_ao_mode(argv[i], param.ao_mode))
+				success = false;
+
+			continue;
+		}
+
+#endif
+#if AO_ANALYTIC != 0
+		if (!strcmp(argv[i] + prefix_len, arg_ao_radius))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%f", &param.ao_radius)) || 0.f >= param.ao_radius)
+				success = false;
+
+			continue;
+		}
+
+#endif
+#if AO_LOD != 0
+		if (!strcmp(argv[i] + prefix_len, arg_ao_lod))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%f", &param.ao_lod)) || 0.f > param.ao_lod)
+				success = false;
+
+			continue;
+		}
+
+#endif
+#if DENOISE != 0
+		if (!strcmp(argv[i] + prefix_len, arg_denoise))
+		{
+			if (!(++i < argc) || (1 != sscanf(argv[i], "%u", &param.denoise)) || render::denoise_passes_max < param.denoise)
+				success = false;
+
+			continue;
+		}
+
+#endif
+#if INTERLEAVE != 0
+		if (!strcmp(argv[i] + prefix_len, arg_interleave))
+		{
+			if (!(++i < argc) || !validate_interleave(argv[i], param.interleave))
+				success = false;
+
+			continue;
+		}
+
+#endif
+
 #if DR_CORE || DR_SUPPLEMENT
 		if (!strcmp(argv[i] + prefix_len, arg_iface))
 		{
@@ -894,6 +1921,43 @@ parse_cli(
 
 #endif
 			"\t" << arg_prefix << arg_nframes << " <unsigned_integer>\t\t: set number of frames to run; default is max unsigned int\n"
+			"\t" << arg_prefix << arg_isa << " <name>\t\t\t\t: force render kernel of the specified ISA level, one of:";
+
+		for (size_t i = 0; i < COUNT_OF(render_kernel); ++i)
+			stream::cerr << ' ' << render_kernel[i].kernel.name;
+
+		stream::cerr << "; default is the best one supported by the host\n"
+			"\t" << arg_prefix << arg_ao_sampling << " <name>\t\t\t: set AO sampling strategy, one of:";
+
+		for (size_t i = 0; i < COUNT_OF(ao_sampling_name); ++i)
+			stream::cerr << ' ' << ao_sampling_name[i];
+
+		stream::cerr << "; default is " << ao_sampling_name[sampling::strategy_random] << "\n"
+
+#if AO_ADAPTIVE != 0
+			"\t" << arg_prefix << arg_ao_tolerance << " <std_error>\t\t: set AO estimate standard error at which a pixel stops tracing probes; default is 0.05\n"
+
+#endif
+#if AO_CONE != 0
+			"\t" << arg_prefix << arg_ao_mode << " <name>\t\t\t: set AO shading mode, one of: probes cones; default is cones\n"
+
+#endif
+#if AO_ANALYTIC != 0
+			"\t" << arg_prefix << arg_ao_radius << " <distance>\t\t\t: set reach of the analytic AO occluders about the hit; default is 2\n"
+
+#endif
+#if AO_LOD != 0
+			"\t" << arg_prefix << arg_ao_lod << " <distance>\t\t\t: set distance past which AO probes take tree leaves for occluders; default is 0 (exact)\n"
+
+#endif
+#if DENOISE != 0
+			"\t" << arg_prefix << arg_denoise << " <passes>\t\t\t: set passes of the AO denoiser, up to " << unsigned(render::denoise_passes_max) << "; default is 2\n"
+
+#endif
+#if INTERLEAVE != 0
+			"\t" << arg_prefix << arg_interleave << " <phases>\t\t\t: set frames over which interleaved rendering covers all pixels, one of: 1 2 4 9; default is 2\n"
+
+#endif
 
 #if DR_CORE || DR_SUPPLEMENT
 			"\t" << arg_prefix << arg_peer << " <oct0:oct1:oct2:oct3:oct4:oct5>\t: MAC of distributed-rendering peer\n"
@@ -941,6 +2005,7 @@ public:
 
 enum IMAGE_FORMAT {
 	IMAGE_FORMAT_GRAY,
+	IMAGE_FORMAT_GRAYX,
 	IMAGE_FORMAT_RGB,
 	IMAGE_FORMAT_RGBX
 };
@@ -961,6 +2026,10 @@ write_png(
 		pixel_size = sizeof(png_byte);
 		color_type = PNG_COLOR_TYPE_GRAY;
 		break;
+	case IMAGE_FORMAT_GRAYX:
+		pixel_size = sizeof(png_byte[2]);
+		color_type = PNG_COLOR_TYPE_GRAY;
+		break;
 	case IMAGE_FORMAT_RGB:
 		pixel_size = sizeof(png_byte[3]);
 		color_type = PNG_COLOR_TYPE_RGB;
@@ -1000,7 +2069,7 @@ write_png(
 	png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
 	png_set_IHDR(png_ptr, info_ptr, w, h, 8, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 	png_write_info(png_ptr, info_ptr);
-	if (IMAGE_FORMAT_RGBX == src_format)
+	if (IMAGE_FORMAT_RGBX == src_format || IMAGE_FORMAT_GRAYX == src_format)
 		png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
 	png_write_image(png_ptr, row());
 	png_write_end(png_ptr, info_ptr);
@@ -1124,6 +2193,9 @@ public:
 	virtual bool init(Timeslice& scene) = 0;
 	virtual bool frame(Timeslice& scene, const float dt) = 0;
 
+	// payload the scene's tree was last built from
+	virtual const Array< Voxel >& get_content() const = 0;
+
 	// scene offset in model space
 	float get_offset_x() const
 	{
@@ -1211,6 +2283,12 @@ public:
 	bool frame(
 		Timeslice& scene,
 		const float dt);
+
+	// virtual from Scene
+	const Array< Voxel >& get_content() const
+	{
+		return content;
+	}
 };
 
 
@@ -1347,6 +2425,12 @@ public:
 	bool frame(
 		Timeslice& scene,
 		const float dt);
+
+	// virtual from Scene
+	const Array< Voxel >& get_content() const
+	{
+		return content;
+	}
 };
 
 
@@ -1471,6 +2555,12 @@ public:
 	bool frame(
 		Timeslice& scene,
 		const float dt);
+
+	// virtual from Scene
+	const Array< Voxel >& get_content() const
+	{
+		return content;
+	}
 };
 
 
@@ -2158,24 +3248,85 @@ int main(
 	stream::cout.open(stdout);
 	stream::cerr.open(stderr);
 
-	const unsigned default_w = 512;
-	const unsigned default_h = 512;
+	const unsigned default_w = 512;
+	const unsigned default_h = 512;
+
+	Param param = {
+		default_w, // param.w 
+		default_h, // param.h 
+		{ 0 },     // param.bitness
+		0,         // param.fsaa
+		-1U,       // param.frames
+		0,         // param.peer_mac
+		0,         // param.iface_name
+		0,         // param.iface_namelen
+		0,         // param.isa_name
+		0.f,       // param.ao_lod
+		sampling::strategy_random, // param.ao_sampling
+		.05f,      // param.ao_tolerance
+		2,         // param.interleave
+		2,         // param.denoise
+		2.f,       // param.ao_radius
+		1          // param.ao_mode
+	};
+
+	const int result_cli = parse_cli(argc, argv, param);
+
+	if (0 != result_cli)
+		return result_cli;
+
+	kernel = select_kernel(param.isa_name);
+
+#if AO_LOD != 0
+	ao_lod = param.ao_lod;
+
+#endif
+#if AO_ADAPTIVE != 0
+	ao_tolerance = param.ao_tolerance;
+
+#endif
+#if AO_ANALYTIC != 0
+	ao_radius = param.ao_radius;
+
+#endif
+#if AO_CONE != 0
+	cone_mode = 0 != param.ao_mode;
+
+#endif
+#if DENOISE != 0
+	denoise_passes = param.denoise;
+
+#endif
+#if INTERLEAVE != 0
+	for (size_t i = 0; i < COUNT_OF(interleave_pattern); ++i)
+		if (interleave_pattern[i].phases == param.interleave)
+			interleave = interleave_pattern + i;
+
+#endif
+	// lay out the AO sample sequence in the order the kernel consumes it
+	for (size_t i = 0; i < ao_probe_count; ++i)
+	{
+		uint32_t u[2];
+		sampling::sample(sampling::Strategy(param.ao_sampling), i, u);
+		ao_sequence[i / 4 * 8 + i % 4 + 0] = u[0];
+		ao_sequence[i / 4 * 8 + i % 4 + 4] = u[1];
+	}
 
-	Param param = {
-		default_w, // param.w 
-		default_h, // param.h 
-		{ 0 },     // param.bitness
-		0,         // param.fsaa
-		-1U,       // param.frames
-		0,         // param.peer_mac
-		0,         // param.iface_name
-		0          // param.iface_namelen
-	};
+	sampling::build_blue_noise(ao_rotation);
+	ao_sequenced = sampling::strategy_random != param.ao_sampling;
 
-	const int result_cli = parse_cli(argc, argv, param);
+#if AO_DIR_TABLE != 0
+	build_probe_dir();
 
-	if (0 != result_cli)
-		return result_cli;
+#endif
+
+	if (0 == kernel)
+	{
+		stream::cerr << "error: render kernel ISA level not supported by host\n";
+		return 1;
+	}
+
+	stream::cout << "render kernel ISA level: " << kernel->name << '\n';
 
 #if FB_RES_FIXED_W
 	const unsigned w = FB_RES_FIXED_W;
@@ -2209,6 +3360,108 @@ int main(
 		return -1;
 	}
 
+#elif DIVISION_OF_LABOR_VER == 3
+#if WORKFORCE_NUMA == 1
+	// find the NUMA node of each worker by the CPU it gets pinned to; number the nodes densely, in order of first worker
+	unsigned node_id[numa_node_max];
+	node_count = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		const unsigned id = node_of_cpu(i);
+		unsigned node = 0;
+
+		while (node < node_count && node_id[node] != id)
+			++node;
+
+		if (node == node_count)
+		{
+			if (numa_node_max == node_count)
+			{
+				stream::cerr << "error: too many NUMA nodes\n";
+				return -1;
+			}
+
+			node_id[node_count] = id;
+			node_lead[node_count] = unsigned(i);
+			++node_count;
+		}
+
+		worker_node[i] = node;
+	}
+
+#endif
+	// cut the frame into a band of tile rows per node, in proportion to the node's workers; order the tiles of each band
+	// along a Morton curve over the smallest power-of-two square grid covering the frame, and split the resulting run
+	// evenly among the node's workers
+	const unsigned tiles_x = (w + tile_size - 1) / tile_size;
+	const unsigned tiles_y = (h + tile_size - 1) / tile_size;
+	unsigned tiles_log2 = 0;
+
+	while ((1U << tiles_log2) < std::max(tiles_x, tiles_y))
+		++tiles_log2;
+
+	Array< uint32_t > tile_order_storage;
+
+	if (!tile_order_storage.setCapacity(tiles_x * tiles_y))
+	{
+		stream::cerr << "error: cannot allocate tile order\n";
+		return -1;
+	}
+
+	size_t workers_before = 0;
+
+	for (unsigned node = 0; node < node_count; ++node)
+	{
+		size_t node_workers = 0;
+
+		for (size_t i = 0; i < nthreads; ++i)
+			node_workers += worker_node[i] == node;
+
+		const unsigned band_y0 = unsigned(tiles_y * workers_before / nthreads);
+		const unsigned band_y1 = unsigned(tiles_y * (workers_before + node_workers) / nthreads);
+		const unsigned begin = unsigned(tile_order_storage.getCount());
+
+		workers_before += node_workers;
+
+		for (uint32_t i = 0; i < 1U << 2 * tiles_log2; ++i)
+		{
+			uint32_t tx = 0;
+			uint32_t ty = 0;
+
+			for (unsigned b = 0; b < tiles_log2; ++b)
+			{
+				tx |= (i >> 2 * b & 1) << b;
+				ty |= (i >> 2 * b + 1 & 1) << b;
+			}
+
+			if (tx < tiles_x && ty >= band_y0 && ty < band_y1)
+				tile_order_storage.addElement(ty << 16 | tx);
+		}
+
+		const unsigned count = unsigned(tile_order_storage.getCount()) - begin;
+
+		for (size_t i = 0, rank = 0; i < nthreads; ++i)
+		{
+			if (worker_node[i] != node)
+				continue;
+
+			worker[i].run = uint64_t(begin + count * (rank + 1) / node_workers) << 32 | begin + count * rank / node_workers;
+
+#if WORKFORCE_NUMA == 1
+			const unsigned y0 = std::min(band_y0 * tile_size, h);
+			const unsigned y1 = std::min(band_y1 * tile_size, h);
+
+			worker[i].rows[0] = unsigned(y0 + (y1 - y0) * rank / node_workers);
+			worker[i].rows[1] = unsigned(y0 + (y1 - y0) * (rank + 1) / node_workers);
+
+#endif
+			++rank;
+		}
+	}
+
+	tile_order = &tile_order_storage.getElement(0);
+
 #endif
 
 #if DR_CORE || DR_SUPPLEMENT
@@ -2239,8 +3492,15 @@ int main(
 
 	const testbed::scoped_ptr< testbed::deinit_resources_t, testbed::scoped_functor > deinitGL(testbed::deinitGL);
 
+#if COMPACT_PIXEL != 0
+	const testbed::rgbv::PixelFormat pixel_format = testbed::rgbv::PIXEL_FORMAT_IA8;
+
+#else
+	const testbed::rgbv::PixelFormat pixel_format = testbed::rgbv::PIXEL_FORMAT_RGBA8;
+
+#endif
 	if (!testbed::util::reportGLCaps() ||
-		!testbed::rgbv::init_resources(w, h))
+		!testbed::rgbv::init_resources(w, h, pixel_format))
 	{
 		stream::cerr << "failed to initialise GL or resources; bailing out\n";
 		return 1;
@@ -2342,14 +3602,14 @@ int main(
 		_mm_set1_ps(.5f));
 	const float rcp_extent = 1.f / std::max(extent[0], std::max(extent[1], extent[2]));
 
-	const size_t frame_size = w * h * sizeof(uint8_t[4]); // our rendering produces RGBA8 pixels
+	const size_t frame_size = w * h * sizeof(render::Pixel); // our rendering produces RGBA8 or compact pixels
 
 	const size_t cacheline_size = 64;
 	const size_t cacheline_pad = cacheline_size - 1;
 
 #if DR_CORE || DR_SUPPLEMENT
-	const compile_assert< 0 == eth::packet_size % sizeof(uint8_t[4]) > assert_eth_packet_size_multiple_of_pixel;
-	const size_t pixels_per_packet = eth::packet_size / sizeof(uint8_t[4]);
+	const compile_assert< 0 == eth::packet_size % sizeof(render::Pixel) > assert_eth_packet_size_multiple_of_pixel;
+	const size_t pixels_per_packet = eth::packet_size / sizeof(render::Pixel);
 	const size_t peer_frame_size = frame_size / (dr_ratio * 2); // for supplement frames take interleave into account
 	const size_t packet_count = peer_frame_size / eth::packet_size + (peer_frame_size % eth::packet_size ? 1 : 0);
 	const size_t room_for_header = cacheline_size; // must be a cacheline_size multiple to preserve the framebuffer alignment
@@ -2358,29 +3618,144 @@ int main(
 #if DR_CORE
 	const size_t room_for_packets = eth::frame_max_size * packet_count;
 
-	const testbed::scoped_ptr< uint8_t[4], generic_free > unaligned_fb(
-		reinterpret_cast< uint8_t(*)[4] >(malloc(room_for_header + frame_size + room_for_packets + cacheline_pad)));
+	const testbed::scoped_ptr< render::Pixel, generic_free > unaligned_fb(
+		reinterpret_cast< render::Pixel* >(malloc(room_for_header + frame_size + room_for_packets + cacheline_pad)));
 
 #elif DR_SUPPLEMENT
-	const testbed::scoped_ptr< uint8_t[4], generic_free > unaligned_fb(
-		reinterpret_cast< uint8_t(*)[4] >(malloc(room_for_header + frame_size + cacheline_pad)));
+	const testbed::scoped_ptr< render::Pixel, generic_free > unaligned_fb(
+		reinterpret_cast< render::Pixel* >(malloc(room_for_header + frame_size + cacheline_pad)));
 
 #else
-	const testbed::scoped_ptr< uint8_t[4], generic_free > unaligned_fb(
-		reinterpret_cast< uint8_t(*)[4] >(malloc(frame_size + cacheline_pad)));
+	const testbed::scoped_ptr< render::Pixel, generic_free > unaligned_fb(
+		reinterpret_cast< render::Pixel* >(malloc(frame_size + cacheline_pad)));
 
 #endif
 
 #if DR_CORE || DR_SUPPLEMENT
 	// get that buffer cacheline aligned
-	uint8_t (* const framebuffer)[4] = reinterpret_cast< uint8_t(*)[4] >((uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad)) + uintptr_t(cacheline_size));
+	render::Pixel* const framebuffer = reinterpret_cast< render::Pixel* >((uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad)) + uintptr_t(cacheline_size));
 	memset(framebuffer, 0, frame_size);
 
+#elif WORKFORCE_NUMA == 1
+	// get that buffer cacheline aligned; leave it to the workers to clear on the first frame, placing its pages on the
+	// nodes rendering them
+	render::Pixel* const framebuffer = reinterpret_cast< render::Pixel* >(uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad));
+
 #else
 	// get that buffer cacheline aligned
-	uint8_t (* const framebuffer)[4] = reinterpret_cast< uint8_t(*)[4] >(uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad));
+	render::Pixel* const framebuffer = reinterpret_cast< render::Pixel* >(uintptr_t(unaligned_fb()) + uintptr_t(cacheline_pad) & ~uintptr_t(cacheline_pad));
 	memset(framebuffer, 0, frame_size);
 
+#endif
+	// per-pixel data persisting across frames; start off as if all pixels missed
+	const testbed::scoped_ptr< render::Aux, generic_free > auxbuffer(
+		reinterpret_cast< render::Aux* >(malloc(w * h * sizeof(render::Aux))));
+
+#if WORKFORCE_NUMA == 0
+	memset(auxbuffer(), 0xff, w * h * sizeof(render::Aux));
+
+#endif
+
+#if AO_TEMPORAL != 0
+	// AO history; start off as if all pixels missed
+	const testbed::scoped_ptr< render::History, generic_free > history_storage(
+		reinterpret_cast< render::History* >(malloc(2 * w * h * sizeof(render::History))));
+	memset(history_storage(), 0xff, 2 * w * h * sizeof(render::History));
+
+	history[0] = history_storage();
+	history[1] = history_storage() + w * h;
+
+#endif
+#if AO_CACHE != 0
+	// AO cache; start off empty -- no key is zero, tags being non-zero
+	const testbed::scoped_ptr< render::AoCacheEntry, generic_free > ao_cache_storage(
+		reinterpret_cast< render::AoCacheEntry* >(malloc(sizeof(render::AoCacheEntry) << render::ao_cache_log2)));
+	memset(ao_cache_storage(), 0, sizeof(render::AoCacheEntry) << render::ao_cache_log2);
+
+	ao_cache = ao_cache_storage();
+
+#endif
+#if AO_CONE != 0
+	// occupancy pyramid for cone-traced AO
+	const testbed::scoped_ptr< float, generic_free > cone_occupancy_storage(
+		reinterpret_cast< float* >(malloc(render::cone_pyramid_count * sizeof(float))));
+	memset(cone_occupancy_storage(), 0, render::cone_pyramid_count * sizeof(float));
+
+	cone_occupancy = cone_occupancy_storage();
+
+#endif
+#if AO_QUAD != 0
+	// quad AO probe sums; start off empty
+	const testbed::scoped_ptr< render::QuadAo, generic_free > quad_ao_storage(
+		reinterpret_cast< render::QuadAo* >(malloc(w * h * sizeof(render::QuadAo))));
+	memset(quad_ao_storage(), 0, w * h * sizeof(render::QuadAo));
+
+	quad_ao = quad_ao_storage();
+
+#endif
+#if DENOISE != 0
+	// denoiser planes, their rows padded on either side; start off as if all pixels missed
+	denoise_pitch = render::denoise_pad * 2 + (w + 3 & ~3U);
+
+	const size_t denoise_plane_size = denoise_pitch * h;
+	const testbed::scoped_ptr< float, generic_free > denoise_storage(
+		reinterpret_cast< float* >(malloc(denoise_plane_size * 5 * sizeof(float))));
+	memset(denoise_storage(), 0, denoise_plane_size * 5 * sizeof(float));
+
+	denoise_visibility = denoise_storage() + denoise_plane_size * 0 + render::denoise_pad;
+	denoise_depth = denoise_storage() + denoise_plane_size * 1 + render::denoise_pad;
+	denoise_key = reinterpret_cast< int32_t* >(denoise_storage() + denoise_plane_size * 2) + render::denoise_pad;
+	denoise_scratch[0] = denoise_storage() + denoise_plane_size * 3 + render::denoise_pad;
+	denoise_scratch[1] = denoise_storage() + denoise_plane_size * 4 + render::denoise_pad;
+
+#endif
+
+#if PRIMARY_RASTER != 0
+	// primary-visibility buffers, their rows padded to a multiple of 4 pixels
+	raster_pitch = w + 3 & ~3U;
+
+	const testbed::scoped_ptr< float, generic_free > raster_depth_storage(
+		reinterpret_cast< float* >(malloc(raster_pitch * h * sizeof(float))));
+	const testbed::scoped_ptr< int32_t, generic_free > raster_id_storage(
+		reinterpret_cast< int32_t* >(malloc(raster_pitch * h * sizeof(int32_t))));
+
+	raster_depth = raster_depth_storage();
+	raster_id = raster_id_storage();
+
+	Array< render::RasterFace > raster_face_storage;
+
+#endif
+#if BEAM_PREPASS != 0
+	const size_t beam_tile_count =
+		(w + render::beam_tile_size - 1) / render::beam_tile_size *
+		((h + render::beam_tile_size - 1) / render::beam_tile_size);
+
+	Array< BeamEntry > beam_entry_storage;
+
+	if (!beam_entry_storage.setCapacity(beam_tile_count) || !beam_entry_storage.addMultiElement(beam_tile_count))
+	{
+		stream::cerr << "error: cannot allocate beam entries\n";
+		return -1;
+	}
+
+	beam_entry = &beam_entry_storage.getMutable(0);
+
+#endif
+#if WORKFORCE_NUMA == 1
+	// per-node tree replicas; left untouched here, so that each gets placed on its node by the first copy to it
+	void* replica_storage = 0;
+
+	if (0 != posix_memalign(&replica_storage, 4096, node_count * sizeof(TimesliceBalloon)))
+	{
+		stream::cerr << "error: cannot allocate tree replicas\n";
+		return -1;
+	}
+
+	const testbed::scoped_ptr< TimesliceBalloon, generic_free > replica(reinterpret_cast< TimesliceBalloon* >(replica_storage));
+
+	for (unsigned i = 0; i < node_count; ++i)
+		tree_replica[i] = replica() + i;
+
 #endif
 #if DR_CORE || DR_SUPPLEMENT
 #if DR_CORE
@@ -2412,7 +3787,7 @@ int main(
 	}
 
 #endif
-	workforce_t workforce(framebuffer, w, h);
+	workforce_t workforce(framebuffer, auxbuffer(), w, h);
 
 	if (!workforce.is_successfully_init())
 	{
@@ -2425,6 +3800,7 @@ int main(
 
 #endif
 	unsigned nframes = 0;
+	uint64_t render_dt = 0;
 	const uint64_t t0 = timer_ns();
 	uint64_t tlast = t0;
 
@@ -2564,7 +3940,56 @@ int main(
 			simd::vect3(mv_inv[3][0], mv_inv[3][1], mv_inv[3][2])
 		};
 
-		workforce.update(nframes, cam, timeline.getElement(c::scene_selector));
+		const Array< Voxel >& content = scene[c::scene_selector]->get_content();
+
+#if PRIMARY_RASTER != 0
+		if (raster_face_storage.getCapacity() < content.getCount() * render::raster_faces_per_item)
+		{
+			if (!raster_face_storage.setCapacity(content.getCount() * render::raster_faces_per_item) ||
+				!raster_face_storage.addMultiElement(content.getCount() * render::raster_faces_per_item))
+			{
+				stream::cerr << "error: cannot allocate raster faces\n";
+				return -1;
+			}
+
+			raster_face = &raster_face_storage.getMutable(0);
+		}
+
+#endif
+#if AO_CACHE != 0
+		// retag the AO cache whenever the tree changes
+		const Timeslice& tree = timeline.getElement(c::scene_selector);
+
+		if (&tree != ao_cache_tree || tree.get_version() != ao_cache_version)
+		{
+			if (!retag_ao_cache(content))
+			{
+				stream::cerr << "error: cannot retag AO cache\n";
+				return -1;
+			}
+
+			ao_cache_tree = &tree;
+			ao_cache_version = tree.get_version();
+		}
+
+#endif
+#if AO_CONE != 0
+		// rebuild the occupancy pyramid whenever the tree changes
+		const Timeslice& cone_tree_now = timeline.getElement(c::scene_selector);
+
+		if (cone_mode && (&cone_tree_now != cone_tree || cone_tree_now.get_version() != cone_version))
+		{
+			const uint64_t tbuild = timer_ns();
+			build_cone_pyramid(content, cone_tree_now.get_root_bbox());
+			cone_build_dt += timer_ns() - tbuild;
+			cone_build_count += 1;
+
+			cone_tree = &cone_tree_now;
+			cone_version = cone_tree_now.get_version();
+		}
+
+#endif
+		workforce.update(nframes, cam, timeline.getElement(c::scene_selector), content);
 
 #if DIVISION_OF_LABOR_VER == 2
 		for (size_t i = 0; i < nthreads; ++i)
@@ -2573,9 +3998,40 @@ int main(
 #elif DIVISION_OF_LABOR_VER == 1
 		workgroup_cursor = 0;
 
+#elif DIVISION_OF_LABOR_VER == 3
+		for (size_t i = 0; i < nthreads; ++i)
+			worker[i].range = worker[i].run;
+
 #endif
-		compute_arg carg(0, nframes, cam, timeline.getElement(c::scene_selector), framebuffer, w, h);
+		compute_arg carg(0, nframes, cam, timeline.getElement(c::scene_selector), content, framebuffer, auxbuffer(), w, h);
+
+		const uint64_t tcompute = timer_ns();
 		compute(&carg);
+		render_dt += timer_ns() - tcompute;
+
+		// charge each worker the time it waited on the last one to run out of pixels
+		uint64_t shade_done = 0;
+
+		for (size_t i = 0; i < nthreads; ++i)
+			shade_done = std::max(shade_done, stats[i].shade_done);
+
+		for (size_t i = 0; i < nthreads; ++i)
+			stats[i].shade_idle += shade_done - stats[i].shade_done;
+
+#if AO_TEMPORAL != 0
+		// reprojection into this frame, for the next one: the rows of the inverse of the camera basis map an offset from
+		// the camera position to the coefficients of that basis
+		const simd::vect3 reproject_x = simd::vect3().cross(cam[1], cam[2]);
+		const simd::vect3 reproject_y = simd::vect3().cross(cam[2], cam[0]);
+		const simd::vect3 reproject_z = simd::vect3().cross(cam[0], cam[1]);
+		const float rcp_det = 1.f / cam[0].dot(reproject_x);
+
+		history_reproject[0] = simd::vect3().mul(reproject_x, rcp_det).getn();
+		history_reproject[1] = simd::vect3().mul(reproject_y, rcp_det).getn();
+		history_reproject[2] = simd::vect3().mul(reproject_z, rcp_det).getn();
+		history_reproject[3] = cam[3].getn();
+
+#endif
 
 #if DR_CORE
 		dt = last_dt;
@@ -2604,7 +4060,7 @@ int main(
 		packet_frame = packets_start;
 
 		for (size_t i = 0; i < packet_count; ++i, packet_frame += eth::frame_max_size) {
-			uint8_t (*packet_payload)[4] = reinterpret_cast< uint8_t (*)[4] >(packet_frame + eth::frame_header_len);
+			const render::Pixel* const packet_payload = reinterpret_cast< const render::Pixel* >(packet_frame + eth::frame_header_len);
 
 			size_t j = 0;
 			do {
@@ -2612,10 +4068,7 @@ int main(
 				const uint32_t x = linear % part_w;
 				const uint32_t checker_offset = nframes % 2 ^ y % 2 ^ 1; // inverse checker to core's
 
-				framebuffer[y * w + x * 2 + checker_offset][0] = packet_payload[j][0];
-				framebuffer[y * w + x * 2 + checker_offset][1] = packet_payload[j][1];
-				framebuffer[y * w + x * 2 + checker_offset][2] = packet_payload[j][2];
-				framebuffer[y * w + x * 2 + checker_offset][3] = packet_payload[j][3];
+				memcpy(framebuffer[y * w + x * 2 + checker_offset], packet_payload[j], sizeof(render::Pixel));
 			} while (++linear != part_frame && ++j < pixels_per_packet);
 
 			if (linear == part_frame)
@@ -2670,9 +4123,15 @@ int main(
 	const uint64_t sequence_dt = timer_ns() - t0;
 
 	stream::cout << "compute_arg size: " << sizeof(compute_arg) <<
-		"\nworker threads: " << nthreads << "\nambient occlusion rays per pixel: " << ao_probe_count <<
+		"\nworker threads: " << nthreads << "\nrender kernel ISA level: " << kernel->name <<
+		"\nambient occlusion rays per pixel: " << ao_probe_count << ", sampling: " << ao_sampling_name[param.ao_sampling] <<
 		"\ntotal frames rendered: " << nframes << '\n';
 
+#if INTERLEAVE != 0
+	stream::cout << "interleaved rendering phases: " << interleave->phases << '\n';
+
+#endif
+
 	if (sequence_dt)
 	{
 		const double sec = double(sequence_dt) * 1e-9;
@@ -2681,6 +4140,201 @@ int main(
 			"\naverage FPS: " << nframes / sec << '\n';
 	}
 
+	if (render_dt)
+	{
+		uint64_t rays = 0;
+
+		for (size_t i = 0; i < nthreads; ++i)
+			rays += stats[i].s.rays;
+
+		const double sec = double(render_dt) * 1e-9;
+
+		stream::cout << "render time: " << sec << " s"
+			"\ntraversal throughput (" << kernel->name << "): " << rays / sec * 1e-6 << " Mrays/s\n";
+
+		uint64_t shade_idle = 0;
+
+		for (size_t i = 0; i < nthreads; ++i)
+			shade_idle += stats[i].shade_idle;
+
+		stream::cout << "worker idle time at end of shading: " << double(shade_idle) / (double(render_dt) * nthreads) * 100.0 << "% of render time\n";
+	}
+
+#if DIVISION_OF_LABOR_VER == 3
+	uint64_t tiles = 0;
+	uint64_t tiles_stolen = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		tiles += stats[i].tiles;
+		tiles_stolen += stats[i].tiles_stolen;
+	}
+
+	if (tiles)
+		stream::cout << "tiles shaded: " << tiles << ", stolen: " << double(tiles_stolen) / tiles * 100.0 << "%\n";
+
+#endif
+#if WORKFORCE_NUMA == 1
+	uint64_t tiles_remote = 0;
+	uint64_t replicas = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		tiles_remote += stats[i].tiles_remote;
+		replicas += stats[i].replicas;
+	}
+
+	stream::cout << "NUMA nodes: " << node_count << ", tree replicas refreshed: " << replicas << '\n';
+
+	if (tiles)
+		stream::cout << "tiles stolen across nodes: " << double(tiles_remote) / tiles * 100.0 << "%\n";
+
+#endif
+
+#if HIT_PREDICTION != 0
+	uint64_t predicted = 0;
+	uint64_t predicted_held = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		predicted += stats[i].s.predicted;
+		predicted_held += stats[i].s.predicted_held;
+	}
+
+	if (predicted)
+		stream::cout << "primary hit predictions: " << predicted << ", held: " << double(predicted_held) / predicted * 100.0 << "%\n";
+
+#endif
+#if TRAVERSE_PREFETCH != 0
+	const unsigned prefetch_distance = TRAVERSE_PREFETCH;
+
+#else
+	const unsigned prefetch_distance = 0;
+
+#endif
+	// shading time per ray stands for the memory stalls of traversal, for comparison across prefetch distances
+	uint64_t rays = 0;
+	uint64_t prefetches = 0;
+	uint64_t shade_busy = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		rays += stats[i].s.rays;
+		prefetches += stats[i].s.prefetches;
+		shade_busy += stats[i].shade_busy;
+	}
+
+	if (rays)
+		stream::cout << "traversal prefetches (distance " << prefetch_distance << "): " << prefetches << ", per ray: " << double(prefetches) / rays <<
+			"\nworker shading time per ray: " << double(shade_busy) / rays << " ns\n";
+
+#if BEAM_PREPASS != 0
+	uint64_t beam_tiles = 0;
+	uint64_t beam_misses = 0;
+	uint64_t beam_levels = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		beam_tiles += stats[i].s.beam_tiles;
+		beam_misses += stats[i].s.beam_misses;
+		beam_levels += stats[i].s.beam_levels;
+	}
+
+	if (beam_tiles)
+		stream::cout << "beam tiles: " << beam_tiles << ", missing the tree: " << double(beam_misses) / beam_tiles * 100.0 <<
+			"%, tree levels skipped per hitting tile: " << (beam_tiles - beam_misses ? double(beam_levels) / (beam_tiles - beam_misses) : 0.0) << '\n';
+
+#endif
+#if AO_ADAPTIVE != 0
+	uint64_t ao_pixels = 0;
+	uint64_t ao_probes_adaptive = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_pixels += stats[i].s.ao_pixels;
+		ao_probes_adaptive += stats[i].s.ao_probes;
+	}
+
+	if (ao_pixels)
+		stream::cout << "AO tolerance: " << ao_tolerance << ", probes per AO pixel: " << double(ao_probes_adaptive) / ao_pixels <<
+			" of " << ao_probe_count << '\n';
+
+#endif
+#if AO_TEMPORAL != 0
+	uint64_t ao_pixels_temporal = 0;
+	uint64_t ao_history = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_pixels_temporal += stats[i].s.ao_pixels;
+		ao_history += stats[i].s.ao_history;
+	}
+
+	if (ao_pixels_temporal)
+		stream::cout << "AO history frames per AO pixel: " << double(ao_history) / ao_pixels_temporal << '\n';
+
+#endif
+#if AO_CACHE != 0
+	uint64_t ao_pixels_cache = 0;
+	uint64_t ao_cached = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_pixels_cache += stats[i].s.ao_pixels;
+		ao_cached += stats[i].s.ao_cached;
+	}
+
+	if (ao_pixels_cache)
+		stream::cout << "AO pixels taken from the AO cache: " << double(ao_cached) / ao_pixels_cache * 100.0 << "%\n";
+
+#endif
+#if AO_ANALYTIC != 0
+	uint64_t ao_pixels_analytic = 0;
+	uint64_t ao_occluders = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_pixels_analytic += stats[i].s.ao_pixels;
+		ao_occluders += stats[i].s.ao_occluders;
+	}
+
+	if (ao_pixels_analytic)
+		stream::cout << "AO radius: " << ao_radius << ", occluder boxes per AO pixel: " << double(ao_occluders) / ao_pixels_analytic << '\n';
+
+#endif
+#if AO_CONE != 0
+	uint64_t ao_pixels_cone = 0;
+	uint64_t ao_cone_steps = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_pixels_cone += stats[i].s.ao_pixels;
+		ao_cone_steps += stats[i].s.ao_cone_steps;
+	}
+
+	stream::cout << "AO mode: " << (cone_mode ? "cones" : "probes") << '\n';
+
+	if (cone_build_count)
+		stream::cout << "AO occupancy pyramid builds: " << cone_build_count << ", time per build: " <<
+			double(cone_build_dt) * 1e-6 / cone_build_count << " ms, cone steps per AO pixel: " <<
+			double(ao_cone_steps) / ao_pixels_cone << '\n';
+
+#endif
+#if AO_LOD != 0
+	uint64_t ao_probes = 0;
+	uint64_t ao_nodes = 0;
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		ao_probes += stats[i].s.ao_probes;
+		ao_nodes += stats[i].s.ao_nodes;
+	}
+
+	if (ao_probes)
+		stream::cout << "AO LOD distance: " << ao_lod << ", tree nodes visited per AO probe: " << double(ao_nodes) / ao_probes << '\n';
+
+#endif
+
 #if VISUALIZE == 0
 	if (nframes) {
 		const char* const name = "last_frame.png";
@@ -2692,7 +4346,14 @@ int main(
 			return -1;
 		}
 
-		if (!write_png(IMAGE_FORMAT_RGBX, w, h, framebuffer, file())) {
+#if COMPACT_PIXEL != 0
+		const IMAGE_FORMAT format = IMAGE_FORMAT_GRAYX;
+
+#else
+		const IMAGE_FORMAT format = IMAGE_FORMAT_RGBX;
+
+#endif
+		if (!write_png(format, w, h, framebuffer, file())) {
 			stream::cerr << "failure writing framegrab file '" << name << "'\n";
 			return -1;
 		}
@@ -1,6 +1,7 @@
 #include <istream>
 #include <ostream>
 #include <limits>
+#include <cstring>
 #include "vectsimd_sse.hpp"
 #include "array.hpp"
 #include "isfinite.hpp"
@@ -14,6 +15,16 @@
 
 __thread const Ray* Timeslice::m_ray;
 __thread HitInfo* Timeslice::m_hit;
+#if HIT_PREDICTION != 0
+__thread float Timeslice::m_bound = __builtin_inff();
+#endif
+#if AO_LOD != 0
+__thread float Timeslice::m_lod_slope;
+__thread uint64_t Timeslice::m_node_count;
+#endif
+#if TRAVERSE_PREFETCH != 0
+__thread uint64_t Timeslice::m_prefetch_count;
+#endif
 
 
 template < size_t DIMENSION_T, typename NATIVE_T >
@@ -335,6 +346,7 @@ bool
 Timeslice::set_payload_array(
 	const Array< Voxel >& payload)
 {
+	++m_version;
 	m_root_bbox = BBox();
 
 	const size_t item_count = payload.getCount();
@@ -342,6 +354,12 @@ Timeslice::set_payload_array(
 	if (item_count == 0)
 	{
 		m_payload.resetCount();
+
+#if HIT_PREDICTION != 0
+		for (size_t i = 0; i < octree_payload_count; ++i)
+			*get_payload_index(i) = PayloadId(-1);
+
+#endif
 		return true;
 	}
 
@@ -384,10 +402,92 @@ Timeslice::set_payload_array(
 	if (cursor > PayloadId(-1))
 		return false;
 
+#if LEAF_PAYLOAD_SOA != 0
+	// produce the SoA copy of the payload, block by block; cells start at block boundaries, so a block never straddles
+	// cells, and lanes past the end of their cell are never tested
+	for (size_t i = 0; i < leaf_count; ++i)
+	{
+		const Leaf& leaf = m_leaf.getElement(i);
+
+		for (size_t j = 0; j < 8; ++j)
+		{
+			const size_t cell_start = leaf.get_start(j);
+			const size_t cell_count = leaf.get_count(j);
+
+			for (size_t k = 0; k < cell_count; ++k)
+			{
+				const Voxel& voxel = m_payload.getElement(cell_start + k);
+				PayloadBlock& block = *get_payload_block(cell_start + k & ~size_t(payload_block_capacity - 1));
+				const size_t lane = cell_start + k & payload_block_capacity - 1;
+
+				block.min_x[lane] = voxel.get_min()[0];
+				block.min_y[lane] = voxel.get_min()[1];
+				block.min_z[lane] = voxel.get_min()[2];
+				block.max_x[lane] = voxel.get_max()[0];
+				block.max_y[lane] = voxel.get_max()[1];
+				block.max_z[lane] = voxel.get_max()[2];
+
+				*get_payload_id(cell_start + k) = PayloadId(voxel.get_id());
+			}
+		}
+	}
+
+#endif
+#if HIT_PREDICTION != 0
+	// index the payload by id; an item duplicated across cells gets indexed by any of its copies
+	for (size_t i = 0; i < octree_payload_count; ++i)
+		*get_payload_index(i) = PayloadId(-1);
+
+	for (size_t i = 0; i < leaf_count; ++i)
+	{
+		const Leaf& leaf = m_leaf.getElement(i);
+
+		for (size_t j = 0; j < 8; ++j)
+		{
+			const size_t cell_start = leaf.get_start(j);
+			const size_t cell_count = leaf.get_count(j);
+
+			for (size_t k = 0; k < cell_count; ++k)
+				*get_payload_index(m_payload.getElement(cell_start + k).get_id()) = PayloadId(cell_start + k);
+		}
+	}
+
+#endif
 	return true;
 }
 
 
+void
+Timeslice::replicate(
+	Timeslice& dst) const
+{
+	// the layout is relocatable, as ArrayLite keeps its elements at offsets relative to itself; the header carries the
+	// counts of the sections, so only their populated extents need copying
+	memcpy(static_cast< void* >(&dst), static_cast< const void* >(this), octree_interior_offset);
+
+	const uint8_t* const src_bits = reinterpret_cast< const uint8_t* >(this);
+	uint8_t* const dst_bits = reinterpret_cast< uint8_t* >(&dst);
+	const size_t payload_count = m_payload.getCount();
+
+	memcpy(dst_bits + octree_interior_offset, src_bits + octree_interior_offset, m_interior.getCount() * sizeof(Octet));
+	memcpy(dst_bits + octree_leaf_offset, src_bits + octree_leaf_offset, m_leaf.getCount() * sizeof(Leaf));
+	memcpy(dst_bits + octree_payload_offset, src_bits + octree_payload_offset, payload_count * sizeof(Voxel));
+
+#if LEAF_PAYLOAD_SOA != 0
+	const size_t block_count = (payload_count + payload_block_capacity - 1) / payload_block_capacity;
+
+	memcpy(dst_bits + octree_payload_soa_offset, src_bits + octree_payload_soa_offset, block_count * sizeof(PayloadBlock));
+	memcpy(dst_bits + octree_payload_id_offset, src_bits + octree_payload_id_offset, payload_count * sizeof(PayloadId));
+
+#endif
+#if HIT_PREDICTION != 0
+	// indexed by payload id rather than by position, so copied whole
+	memcpy(dst_bits + octree_payload_index_offset, src_bits + octree_payload_index_offset, octree_payload_index_sizeof);
+
+#endif
+}
+
+
 #if CLANG_QUIRK_0001 != 0
 bool
 Timeslice::traverse(
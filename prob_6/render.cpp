@@ -0,0 +1,1429 @@
+// Render kernel translation unit, built once per ISA level (see RENDER_ISA in build_glx.sh); the ISA level name comes
+// from the RENDER_ISA macro, and the ISA itself from the target flags this unit is compiled with
+
+#ifndef RENDER_ISA
+#error RENDER_ISA required
+#endif
+
+// system headers go first so that the inclusions below find them already guarded
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <cassert>
+#include <istream>
+#include <ostream>
+#include <limits>
+#include <algorithm>
+#include <immintrin.h>
+#include "cmath_fix"
+#include "render.hpp"
+
+// keep every entity coming from the shared headers private to this ISA level, as the same inline entities compiled for
+// different ISA levels must not be merged by the linker; the traversal entry points are needed inline here
+#undef CLANG_QUIRK_0001
+#define CLANG_QUIRK_0001 0
+
+namespace {
+
+#include "sse_mathfun.h"
+#include "vectsimd_sse.hpp"
+#include "problem_7.hpp"
+
+__thread const Ray* Timeslice::m_ray;
+__thread HitInfo* Timeslice::m_hit;
+#if HIT_PREDICTION != 0
+__thread float Timeslice::m_bound = __builtin_inff();
+#endif
+#if AO_LOD != 0
+__thread float Timeslice::m_lod_slope;
+__thread uint64_t Timeslice::m_node_count;
+#endif
+#if TRAVERSE_PREFETCH != 0
+__thread uint64_t Timeslice::m_prefetch_count;
+#endif
+
+static const size_t ao_probe_count = AO_NUM_RAYS;
+
+static const compile_assert< ao_probe_count % 4 == 0 > assert_ao_probe_count_even;
+
+#if DENOISE != 0
+// hit distances, relative to that at the filtered pixel and per pixel of tap step, past which denoiser taps fade; taps
+// off the same item face are allowed wider distances than taps off other items, so that only coplanar-looking faces blend
+static const float denoise_depth_same = .1f;
+static const float denoise_depth_other = .01f;
+
+#endif
+#if AO_TEMPORAL != 0
+// history accumulates the probes over frames, so each frame traces half of them, over all pixels rather than half
+static const size_t ao_probe_budget = ao_probe_count / 2;
+static const size_t ao_history_cap = 16; // frames past which new AO blends into history at a fixed rate
+
+static const compile_assert< ao_probe_budget % 4 == 0 > assert_ao_probe_budget_even;
+
+#endif
+#if AO_QUAD != 0
+// the pixels of each 2x2 quad trace disjoint quarters of the quad's probes, for the quad to gather them
+static const size_t ao_probe_budget = ao_probe_count / 4;
+
+static const compile_assert< ao_probe_budget % 4 == 0 > assert_ao_probe_budget_even;
+
+#endif
+#if AO_ANALYTIC != 0
+// AO comes in closed form from the boxes about the hit, tracing no probes
+static const size_t ao_probe_budget = 0;
+static const size_t ao_occluder_capacity = 256; // boxes taken for occluders at most
+
+#endif
+#if AO_TEMPORAL == 0 && AO_QUAD == 0 && AO_ANALYTIC == 0
+static const size_t ao_probe_budget = ao_probe_count;
+
+#endif
+
+#if AO_ADAPTIVE != 0
+static const size_t ao_probe_min = 8; // probes traced before the AO estimate may be deemed converged
+
+#endif
+
+
+inline __m128 __attribute__ ((always_inline))
+permute_dir(
+	const __m128 dir,
+	const size_t axis)
+{
+#if __AVX__
+	return _mm_permutevar_ps(dir, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(axis)));
+
+#else
+	// low byte of the packed permutation identifies it: 0 - x-axis, 2 - y-axis, 1 - z-axis
+	switch (axis & 3) {
+	case 2:
+		return _mm_shuffle_ps(dir, dir, _MM_SHUFFLE(3, 1, 0, 2));
+	case 1:
+		return _mm_shuffle_ps(dir, dir, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	return dir;
+
+#endif
+}
+
+
+#if AO_ANALYTIC != 0
+// coverage of the hemisphere above a surface by a face of an axis-aligned box, weighted as by the AO probes -- by the
+// cosine to the surface normal on top of their cosine-weighted distribution; the face is given by its corners in cyclic
+// order, relative to the point on the surface, and must not reach below the surface. By the divergence theorem, the
+// integral of the squared cosine over the solid angle of a polygon is a third of the solid angle plus a sum over the
+// edges; the hemisphere integrates to 2pi/3
+inline float
+face_coverage(
+	const simd::vect3 (& corner)[4],
+	const size_t normal_axis)
+{
+	float sum = 0.f;
+
+	// solid angle, as that of two triangles fanning out of the first corner
+	for (size_t k = 1; k < 3; ++k)
+	{
+		const simd::vect3& p = corner[0];
+		const simd::vect3& q = corner[k];
+		const simd::vect3& r = corner[k + 1];
+		const float lp = sqrtf(p.dot(p));
+		const float lq = sqrtf(q.dot(q));
+		const float lr = sqrtf(r.dot(r));
+
+		sum += 2.f * atan2f(p.dot(simd::vect3().cross(q, r)), lp * lq * lr + p.dot(q) * lr + p.dot(r) * lq + q.dot(r) * lp);
+	}
+
+	// edges: the normal component of the unit normal of the edge plane through the point, times the integral of the
+	// normal component of the direction along the edge arc
+	for (size_t k = 0; k < 4; ++k)
+	{
+		const simd::vect3& p = corner[k];
+		const simd::vect3& q = corner[(k + 1) % 4];
+		const simd::vect3 n = simd::vect3().cross(p, q);
+		const float len = sqrtf(n.dot(n));
+
+		if (0.f == len)
+			continue;
+
+		const simd::vect3 a = simd::vect3().mul(p, 1.f / sqrtf(p.dot(p)));
+		const simd::vect3 b = simd::vect3().sub(q, simd::vect3().mul(a, q.dot(a)));
+		const float angle = atan2f(len, p.dot(q));
+		const float arc = a[normal_axis] * sinf(angle) + b[normal_axis] / sqrtf(b.dot(b)) * (1.f - cosf(angle));
+
+		sum += n[normal_axis] / len * arc;
+	}
+
+	return fabsf(sum) * float(.5 / M_PI);
+}
+
+// coverage of the hemisphere above a surface facing along the given axis by an axis-aligned box, given relative to the
+// point on the surface, not reaching below the surface -- the sum of the coverage by the box faces facing the point
+inline float
+box_coverage(
+	const __m128 min,
+	const __m128 max,
+	const size_t normal_axis)
+{
+	float sum = 0.f;
+
+	for (size_t a = 0; a < 3; ++a)
+	{
+		const bool below = 0.f < min[a];
+		const bool above = 0.f > max[a];
+
+		if (!below && !above)
+			continue;
+
+		const size_t u = (a + 1) % 3;
+		const size_t v = (a + 2) % 3;
+
+		simd::vect3 corner[4];
+
+		for (size_t k = 0; k < 4; ++k)
+		{
+			float c[3];
+			c[a] = below ? min[a] : max[a];
+			c[u] = 1 == k || 2 == k ? max[u] : min[u];
+			c[v] = 2 <= k ? max[v] : min[v];
+			corner[k] = simd::vect3(c);
+		}
+
+		sum += face_coverage(corner, normal_axis);
+	}
+
+	return sum;
+}
+
+#endif
+#if AO_CONE != 0
+// AO cones, in the TBN space of a normal along x-axis: one along the normal, and a ring of five about it, 60 degrees
+// off the normal; each is 60 degrees wide. Cones are weighted by the squared cosine of their axes to the normal, as the
+// AO probes weigh their directions
+static const float cone_dir[][4] __attribute__ ((aligned(16))) = {
+	{ 1.f,  0.f,                    0.f,                    0.f },
+	{ .5f,  .8660254f,              0.f,                    0.f },
+	{ .5f,  .8660254f * .30901699f, .8660254f * .95105652f, 0.f },
+	{ .5f, -.8660254f * .80901699f, .8660254f * .58778525f, 0.f },
+	{ .5f, -.8660254f * .80901699f, -.8660254f * .58778525f, 0.f },
+	{ .5f,  .8660254f * .30901699f, -.8660254f * .95105652f, 0.f }
+};
+
+static const float cone_weight[] = { 1.f / 2.25f, .25f / 2.25f, .25f / 2.25f, .25f / 2.25f, .25f / 2.25f, .25f / 2.25f };
+static const float cone_tan_half = .57735027f; // tangent of the cone half-angle
+static const float cone_offset = 2.f;          // cells of the finest level off the surface cones start from
+
+// trilinear sample of a level of the occupancy pyramid, of the given cells per axis, at the given position, in cells of
+// that level; the position is clamped to the cell centers at the sides of the cube; the single cell of the top level
+// has no neighbours to blend with, so it is taken as is
+inline float
+cone_sample(
+	const float* const level,
+	const int size,
+	const __m128 pos)
+{
+	if (1 == size)
+		return level[0];
+
+	const __m128 p = _mm_min_ps(_mm_max_ps(_mm_sub_ps(pos, _mm_set1_ps(.5f)), _mm_setzero_ps()), _mm_set1_ps(size - 1.001f));
+	const __m128i i = _mm_cvttps_epi32(p);
+	const __m128 f = _mm_sub_ps(p, _mm_cvtepi32_ps(i));
+
+	const size_t row = size;
+	const size_t slice = row * row;
+	const float* const c = level + (size_t(_mm_extract_epi16(i, 4)) * row + size_t(_mm_extract_epi16(i, 2))) * row + size_t(_mm_cvtsi128_si32(i));
+
+	// lerp along x the four pairs of cells, then along y and z
+	const __m128 c0 = _mm_setr_ps(c[0], c[row], c[slice], c[slice + row]);
+	const __m128 c1 = _mm_setr_ps(c[1], c[row + 1], c[slice + 1], c[slice + row + 1]);
+	const __m128 x = _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), _mm_shuffle_ps(f, f, _MM_SHUFFLE(0, 0, 0, 0))));
+	const float y0 = x[0] + (x[1] - x[0]) * f[1];
+	const float y1 = x[2] + (x[3] - x[2]) * f[1];
+
+	return y0 + (y1 - y0) * f[2];
+}
+
+// AO visibility of a hit by cones marched through the occupancy pyramid: each cone samples the level whose cells match
+// its width, blending between the two nearest levels, in steps of its width; occlusion is composited front to back
+inline float
+cone_visibility(
+	const render::Frame& frame,
+	const simd::vect3& orig,
+	const size_t axis,
+	const __m128 axis_sign,
+	render::Stats& stats)
+{
+	const int size = render::cone_grid_size;
+	const float scale = frame.cone_scale;
+
+	// march in cells of the finest level, from a couple of cells off the surface, for the cells of the surface not to
+	// occlude it
+	const __m128 normal = _mm_xor_ps(permute_dir(_mm_load_ps(cone_dir[0]), axis), axis_sign);
+	const __m128 start = _mm_add_ps(
+		_mm_mul_ps(_mm_sub_ps(orig.getn(), frame.cone_origin), _mm_set1_ps(scale)),
+		_mm_mul_ps(normal, _mm_set1_ps(cone_offset)));
+
+	float visibility = 0.f;
+
+	for (size_t i = 0; i < sizeof(cone_dir) / sizeof(cone_dir[0]); ++i)
+	{
+		const __m128 dir = _mm_xor_ps(permute_dir(_mm_load_ps(cone_dir[i]), axis), axis_sign);
+
+		float occlusion = 0.f;
+		float t = 1.f;
+
+		while (occlusion < .99f)
+		{
+			const float diameter = std::max(2.f * cone_tan_half * t, 1.f);
+			const float level = log2f(diameter);
+
+			if (level >= render::cone_grid_log2)
+				break;
+
+			const int level0 = int(level);
+			const float frac = level - level0;
+			const __m128 pos = _mm_add_ps(start, _mm_mul_ps(dir, _mm_set1_ps(t)));
+
+			// past the sides of the cube there is nothing to occlude
+			if (0 != (7 & _mm_movemask_ps(_mm_or_ps(
+					_mm_cmplt_ps(pos, _mm_setzero_ps()),
+					_mm_cmpge_ps(pos, _mm_set1_ps(float(size)))))))
+			{
+				break;
+			}
+
+			float occupancy = 0.f;
+
+			for (int j = 0; j < 2; ++j)
+			{
+				const int size_j = size >> (level0 + j);
+				const size_t offset = size_t(size * size * size - size_j * size_j * size_j) / 7 * 8;
+				const __m128 pos_j = _mm_mul_ps(pos, _mm_set1_ps(1.f / (1 << (level0 + j))));
+
+				occupancy += (0 == j ? 1.f - frac : frac) * cone_sample(frame.cone_occupancy + offset, size_j, pos_j);
+			}
+
+			// steps are as long as the cells sampled are wide, so occupancy stands for opacity
+			occlusion += (1.f - occlusion) * occupancy;
+			t += diameter;
+
+			stats.ao_cone_steps += 1;
+		}
+
+		visibility += cone_weight[i] * (1.f - occlusion);
+	}
+
+	return visibility;
+}
+
+#endif
+// closest-hit traversal of the primary ray of pixel (x, y), from the beam entry of the pixel's tile if available
+inline bool __attribute__ ((always_inline))
+traverse_primary(
+	const render::Frame& frame,
+	const unsigned x,
+	const unsigned y,
+	const Ray& ray,
+	HitInfo& hit)
+{
+	const Timeslice& ts = *reinterpret_cast< const Timeslice* >(frame.tree);
+
+#if BEAM_PREPASS != 0
+	if (0 != frame.beam)
+	{
+		const BeamEntry* const beam = reinterpret_cast< const BeamEntry* >(frame.beam);
+		return ts.traverse(ray, hit, beam[y / render::beam_tile_size * frame.beam_tiles_x + x / render::beam_tile_size]);
+	}
+
+#endif
+	return ts.traverse(ray, hit);
+}
+
+// decode a plane hit: the axis permutation and normal sign of the plane, and the hit point
+inline void __attribute__ ((always_inline))
+decode_hit(
+	const Ray& ray,
+	const HitInfo& hit,
+	size_t& axis,
+	__m128& axis_sign,
+	simd::vect3& orig)
+{
+	axis_sign = _mm_and_ps(_mm_set1_ps(-0.f), hit.min_mask);
+
+	const int xyz = 0x020100; // x-axis: 0 1 2
+	const int zxy = 0x010002; // y-axis: 2 0 1
+	const int yzx = 0x000201; // z-axis: 1 2 0
+
+	axis = (xyz & hit.a_mask | zxy & ~hit.a_mask) & hit.b_mask | yzx & ~hit.b_mask;
+	orig = simd::vect3().add(ray.get_origin(), simd::vect3().mul(ray.get_direction(), hit.dist));
+}
+
+// trace a batch of 4 AO probes off a hit, given the cosines of their directions to the hit normal; add the cosines of
+// the unoccluded probes to lit and those of all probes to all; return the mask of the unoccluded probes
+inline __m128i __attribute__ ((always_inline))
+trace_probes(
+	const Timeslice& ts,
+	const Ray& probe0,
+	const Ray& probe1,
+	const Ray& probe2,
+	const Ray& probe3,
+	const __m128 cos_decl,
+	HitInfo& hit,
+	__m128& lit,
+	__m128& all)
+{
+	const __m128i shadow_hit = _mm_setr_epi32(
+		ts.traverse_litest(probe0, hit) ? 0 : -1,
+		ts.traverse_litest(probe1, hit) ? 0 : -1,
+		ts.traverse_litest(probe2, hit) ? 0 : -1,
+		ts.traverse_litest(probe3, hit) ? 0 : -1);
+
+	lit = _mm_add_ps(lit, _mm_and_ps(cos_decl, _mm_castsi128_ps(shadow_hit)));
+	all = _mm_add_ps(all, cos_decl);
+
+	return shadow_hit;
+}
+
+// trace a batch of 4 AO probes off a hit, cosine-distributed over the hemisphere about its normal by the given 32-bit
+// declination and azimuth samples; accumulate and return as trace_probes does
+inline __m128i __attribute__ ((always_inline))
+trace_hemisphere_probes(
+	const Timeslice& ts,
+	const simd::vect3& orig,
+	const size_t axis,
+	const __m128 axis_sign,
+	const __m128i ri0,
+	const __m128i ri1,
+	HitInfo& hit,
+	__m128& lit,
+	__m128& all)
+{
+	// cosine-weighted distribution
+	const __m128 r0 = prng::unit(ri0); // decl0-3 (cos^2)
+	const __m128 r1 = _mm_mul_ps(prng::unit(ri1), _mm_set1_ps(M_PI * 2)); // azim0-3
+	const __m128 sin_decl = _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.f), r0));
+	const __m128 cos_decl = _mm_sqrt_ps(r0);
+	__m128 sin_azim;
+	__m128 cos_azim;
+	sincos_ps(r1, &sin_azim, &cos_azim);
+
+	// compute a bounce vector in some TBN space, in this case of an assumed normal along x-axis
+	simd::vect3 hemi0 = simd::vect3(cos_decl[0], cos_azim[0] * sin_decl[0], sin_azim[0] * sin_decl[0], true);
+	simd::vect3 hemi1 = simd::vect3(cos_decl[1], cos_azim[1] * sin_decl[1], sin_azim[1] * sin_decl[1], true);
+	simd::vect3 hemi2 = simd::vect3(cos_decl[2], cos_azim[2] * sin_decl[2], sin_azim[2] * sin_decl[2], true);
+	simd::vect3 hemi3 = simd::vect3(cos_decl[3], cos_azim[3] * sin_decl[3], sin_azim[3] * sin_decl[3], true);
+
+	// permute bounce direction depending on which axial plane was hit
+	const __m128 pdir0 = permute_dir(hemi0.getn(), axis);
+	const __m128 pdir1 = permute_dir(hemi1.getn(), axis);
+	const __m128 pdir2 = permute_dir(hemi2.getn(), axis);
+	const __m128 pdir3 = permute_dir(hemi3.getn(), axis);
+
+	simd::vect3 probe_dir0;
+	simd::vect3 probe_dir1;
+	simd::vect3 probe_dir2;
+	simd::vect3 probe_dir3;
+
+	probe_dir0.setn(0, _mm_xor_ps(pdir0, axis_sign));
+	probe_dir1.setn(0, _mm_xor_ps(pdir1, axis_sign));
+	probe_dir2.setn(0, _mm_xor_ps(pdir2, axis_sign));
+	probe_dir3.setn(0, _mm_xor_ps(pdir3, axis_sign));
+
+	const Ray probe0(orig, probe_dir0);
+	const Ray probe1(orig, probe_dir1);
+	const Ray probe2(orig, probe_dir2);
+	const Ray probe3(orig, probe_dir3);
+
+	return trace_probes(ts, probe0, probe1, probe2, probe3, cos_decl, hit, lit, all);
+}
+
+#if PRIMARY_JITTER == 0
+
+void
+shade(
+	const render::Frame& frame,
+	const unsigned x,
+	const unsigned y,
+	prng::State& rng,
+	render::Pixel& pixel,
+	render::Aux& aux,
+	render::Stats& stats)
+{
+	// the opaque types are this unit's own Timeslice and Voxel -- same definitions, just compiled for this ISA level
+	const Timeslice& ts = *reinterpret_cast< const Timeslice* >(frame.tree);
+	const unsigned w = frame.w;
+	const unsigned h = frame.h;
+
+#if (PRIMARY_RASTER != 0 && DRAW_TREE_CELLS == 0) || AO_CACHE != 0 || AO_ANALYTIC != 0
+	const Voxel* const content = reinterpret_cast< const Voxel* >(frame.content);
+
+#endif
+	simd::vect3 cam_x, cam_y, cam_z, cam_o;
+	cam_x.setn(0, frame.cam[0]);
+	cam_y.setn(0, frame.cam[1]);
+	cam_z.setn(0, frame.cam[2]);
+	cam_o.setn(0, frame.cam[3]);
+
+	const simd::vect3 offs = simd::vect3().add(
+		cam_y.mul((int(y) * 2 - int(h)) * (1.f / h)),
+		cam_x.mul((int(x) * 2 - int(w)) * (1.f / w)));
+
+	const Ray ray(cam_o, simd::vect3().add(cam_z, offs));
+
+	HitInfo hit;
+	hit.target = PayloadId(-1);
+
+#if PRIMARY_RASTER != 0 && DRAW_TREE_CELLS == 0
+	// rasterized primary visibility leaves only the hit details to the nearest item; should those not come out of
+	// the item (e.g. for a pixel grazing an item edge), trace the primary ray after all
+	const int32_t raster_id = 0 != frame.raster_id ? frame.raster_id[y * frame.raster_pitch + x] : -2;
+
+	if (-1 == raster_id)
+	{
+		render::set_intensity(pixel, 0);
+		pixel[render::pixel_key] = 0;
+		aux.target = uint16_t(-1);
+
+#if AO_TEMPORAL != 0
+		frame.history[y * frame.w + x].target = uint16_t(-1);
+
+#endif
+#if DENOISE != 0
+		frame.denoise_key[y * frame.denoise_pitch + x] = 0;
+
+#endif
+		return;
+	}
+
+	const bool rasterized = 0 <= raster_id &&
+		content[raster_id].get_bbox().intersect(ray, hit.min_mask, hit.a_mask, hit.b_mask, hit.dist);
+
+	if (rasterized)
+		hit.target = PayloadId(raster_id);
+
+#else
+	const bool rasterized = false;
+
+#endif
+	stats.rays += rasterized ? 0 : 1;
+
+#if HIT_PREDICTION != 0 && DRAW_TREE_CELLS == 0
+	// the item hit at this pixel last frame is likely hit again -- if so, seed the traversal with that hit, so that only
+	// nearer hits are sought; the seed is an actual hit in the tree, so the outcome is the same as without prediction
+	const Voxel* const predicted = rasterized ? 0 : ts.get_payload(aux.target);
+	const bool seeded = 0 != predicted &&
+		predicted->get_bbox().intersect(ray, hit.min_mask, hit.a_mask, hit.b_mask, hit.dist);
+
+	if (seeded)
+	{
+		hit.target = aux.target;
+
+		stats.predicted += 1;
+		stats.predicted_held += ts.traverse_seeded(ray, hit) ? 0 : 1;
+	}
+
+	if (!rasterized && !seeded && !traverse_primary(frame, x, y, ray, hit))
+#else
+	if (!rasterized && !traverse_primary(frame, x, y, ray, hit))
+#endif
+	{
+		render::set_intensity(pixel, 0);
+		pixel[render::pixel_key] = 0;
+		aux.target = uint16_t(-1);
+
+#if AO_TEMPORAL != 0
+		frame.history[y * frame.w + x].target = uint16_t(-1);
+
+#endif
+#if DENOISE != 0
+		frame.denoise_key[y * frame.denoise_pitch + x] = 0;
+
+#endif
+		return;
+	}
+
+#if DRAW_TREE_CELLS == 1
+	const uint8_t color_r[8] = { 255, 127,  63,  63,   0,   0,   0,   0 };
+	const uint8_t color_g[8] = {   0,  63, 127, 255, 255, 127,  63,   0 };
+	const uint8_t color_b[8] = {   0,   0,   0,   0,  63,  63, 127, 255 };
+
+	assert(8 > hit.target);
+
+	pixel[0] = color_r[hit.target];
+	pixel[1] = color_g[hit.target];
+	pixel[2] = color_b[hit.target];
+	aux.target = uint16_t(-1);
+	return;
+
+#endif
+	size_t axis;
+	__m128 axis_sign;
+	simd::vect3 orig;
+	decode_hit(ray, hit, axis, axis_sign, orig);
+
+	__m128 lit = _mm_set1_ps(0.f);
+	__m128 all = _mm_set1_ps(0.f);
+
+#if AO_LOD != 0
+	ts.set_lod_distance(frame.ao_lod);
+
+#endif
+#if AO_DIR_TABLE != 0 || AO_TEMPORAL != 0 || AO_CACHE != 0 || AO_ANALYTIC != 0
+	const size_t normal = 0x120 >> (axis & 3) * 4 & 3; // 0 - x-axis, 1 - y-axis, 2 - z-axis
+
+#endif
+#if AO_DIR_TABLE != 0 || AO_TEMPORAL != 0 || AO_CACHE != 0
+	// face orientation of the hit: x+, x-, y+, y-, z+, z-
+	const size_t face = normal * 2 + (_mm_movemask_ps(axis_sign) >> normal & 1);
+
+#endif
+#if AO_QUAD != 0
+	// pixels of a quad share the rotation of their sampling, and take their quarters of it by position in the quad
+	const unsigned quarter = (y & 1) * 2 + (x & 1);
+	const unsigned rotation_x = x & ~1U;
+	const unsigned rotation_y = y & ~1U;
+
+#else
+	const unsigned quarter = 0;
+	const unsigned rotation_x = x;
+	const unsigned rotation_y = y;
+
+#endif
+#if AO_DIR_TABLE != 0
+	// probe directions come from the table of the face orientation, in a window starting at a per-pixel offset -- from
+	// the blue-noise mask when sequenced or gathered over quads, random otherwise
+	const render::ProbeDir* const table = frame.probe_dir[face];
+
+	uint32_t r[2];
+
+#if AO_QUAD != 0
+	const bool rotated = true;
+
+#else
+	const bool rotated = 0 != frame.ao_sequence;
+
+#endif
+	if (rotated)
+	{
+		sampling::rotation(*frame.ao_rotation, rotation_x, rotation_y, r);
+		r[0] += frame.ao_shift[0];
+	}
+	else
+	{
+		__m128i ri0;
+		__m128i ri1;
+		prng::next(rng, ri0, ri1);
+		r[0] = _mm_cvtsi128_si32(ri0);
+	}
+
+	const size_t offset = (r[0] >> 32 - render::probe_dir_log2 & size_t(-4)) + quarter * ao_probe_budget;
+
+#else
+	// a low-discrepancy sequence is shared by all pixels, each rotating it by its own value of a blue-noise mask
+	__m128i rotation0 = _mm_setzero_si128();
+	__m128i rotation1 = _mm_setzero_si128();
+
+	if (0 != frame.ao_sequence)
+	{
+		uint32_t r[2];
+		sampling::rotation(*frame.ao_rotation, rotation_x, rotation_y, r);
+		rotation0 = _mm_set1_epi32(r[0] + frame.ao_shift[0]);
+		rotation1 = _mm_set1_epi32(r[1] + frame.ao_shift[1]);
+	}
+
+#endif
+#if AO_ADAPTIVE != 0
+	const float tolerance2 = frame.ao_tolerance * frame.ao_tolerance;
+	size_t lit_count = 0;
+
+#endif
+	size_t probe_count = ao_probe_budget;
+
+#if AO_CONE != 0
+	// cone-traced AO traces no probes
+	if (0 != frame.cone_occupancy)
+		probe_count = 0;
+
+#endif
+
+#if AO_CACHE != 0
+	// look up the texel of the hit in the AO cache, keyed by item tag, face orientation and texel coordinates along the
+	// face; trace no probes if the texel has converged
+	const size_t axis_u = 0 == normal ? 1 : 0;
+	const size_t axis_v = 2 == normal ? 1 : 2;
+
+	int32_t texel[4] __attribute__ ((aligned(16)));
+	_mm_store_si128(reinterpret_cast< __m128i* >(texel), _mm_cvttps_epi32(_mm_mul_ps(
+		_mm_sub_ps(orig.getn(), content[hit.target].get_bbox().get_min()),
+		_mm_set1_ps(1 << render::ao_cache_texel_log2))));
+
+	const uint64_t texel_u = uint32_t(texel[axis_u]) & 0x3fff;
+	const uint64_t texel_v = uint32_t(texel[axis_v]) & 0x3fff;
+	const uint64_t cache_key = uint64_t(frame.ao_cache_tag[hit.target]) << 32 | face << 28 | texel_u << 14 | texel_v;
+
+	render::AoCacheEntry& cache_entry = frame.ao_cache[cache_key * 0x9e3779b97f4a7c15ULL >> 64 - render::ao_cache_log2];
+	const uint64_t cache_check = __atomic_load_n(&cache_entry.check, __ATOMIC_RELAXED);
+	const uint64_t cache_data = __atomic_load_n(&cache_entry.data, __ATOMIC_RELAXED);
+
+	float cached_visibility = 0.f;
+	uint32_t cached_count = 0;
+
+	if ((cache_check ^ cache_data) == cache_key)
+	{
+		const uint32_t bits = uint32_t(cache_data);
+		memcpy(&cached_visibility, &bits, sizeof(cached_visibility));
+		cached_count = uint32_t(cache_data >> 32);
+	}
+
+	if (render::ao_cache_converged <= cached_count)
+		probe_count = 0;
+
+#endif
+	// manually unroll the AO shading loop by 4
+	for (size_t i = 0; i < probe_count / 4; ++i)
+	{
+#if AO_DIR_TABLE != 0
+		const size_t j = offset + i * 4 & render::probe_dir_count - 1;
+		const __m128 cos_decl = _mm_load_ps(frame.probe_cos + j);
+
+		simd::vect3 probe_dir[4];
+		simd::vect3 probe_rcpdir[4];
+
+		for (size_t k = 0; k < 4; ++k)
+		{
+			probe_dir[k].setn(0, table[j + k].dir);
+			probe_rcpdir[k].setn(0, table[j + k].rcpdir);
+		}
+
+		const Ray probe0(orig, probe_dir[0], probe_rcpdir[0]);
+		const Ray probe1(orig, probe_dir[1], probe_rcpdir[1]);
+		const Ray probe2(orig, probe_dir[2], probe_rcpdir[2]);
+		const Ray probe3(orig, probe_dir[3], probe_rcpdir[3]);
+
+		const __m128i shadow_hit = trace_probes(ts, probe0, probe1, probe2, probe3, cos_decl, hit, lit, all);
+
+#else
+		__m128i ri0;
+		__m128i ri1;
+
+		if (0 != frame.ao_sequence)
+		{
+			const __m128i* const seq = reinterpret_cast< const __m128i* >(frame.ao_sequence) + (quarter * ao_probe_budget / 4 + i) * 2;
+			ri0 = _mm_add_epi32(_mm_load_si128(seq + 0), rotation0);
+			ri1 = _mm_add_epi32(_mm_load_si128(seq + 1), rotation1);
+		}
+		else
+		{
+			prng::next(rng, ri0, ri1);
+
+#if AO_QUAD != 0
+			// random azimuths of a pixel fall in its quarter of the circle
+			ri1 = _mm_or_si128(_mm_srli_epi32(ri1, 2), _mm_set1_epi32(quarter << 30));
+
+#endif
+		}
+
+		const __m128i shadow_hit = trace_hemisphere_probes(ts, orig, axis, axis_sign, ri0, ri1, hit, lit, all);
+
+#endif
+#if AO_ADAPTIVE != 0
+		// stop once the standard error of the visibility estimate, taken with a uniform prior, is within tolerance
+		lit_count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(shadow_hit)));
+
+		const size_t n = i * 4 + 4;
+		const float p = (lit_count + 1.f) / (n + 2.f);
+
+		if (ao_probe_min <= n && p * (1.f - p) <= tolerance2 * n)
+		{
+			probe_count = n;
+			break;
+		}
+
+#else
+		(void) shadow_hit;
+
+#endif
+	}
+
+#if DRAW_AO_PROBES != 0
+	// heatmap of the probes traced: blue for the fewest, red for all
+	const float heat = float(probe_count) / ao_probe_budget;
+
+	pixel[0] = uint8_t(255.f * heat);
+	pixel[1] = 0;
+	pixel[2] = uint8_t(255.f * (1.f - heat));
+
+#else
+#if AO_ANALYTIC != 0
+	// take the boxes within reach of the hit for occluders, clipped to the reach and to the hemisphere above the hit;
+	// overlaps in their coverage are approximated by taking the boxes for independent occluders
+	const __m128 on_normal = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(normal)));
+	const __m128 reach = _mm_set1_ps(frame.ao_radius);
+
+	__m128 clip_min = _mm_sub_ps(orig.getn(), reach);
+	__m128 clip_max = _mm_add_ps(orig.getn(), reach);
+
+	// the face hit faces the ray origin
+	if (0.f < ray.get_direction()[normal])
+		clip_max = _mm_or_ps(_mm_and_ps(on_normal, orig.getn()), _mm_andnot_ps(on_normal, clip_max));
+	else
+		clip_min = _mm_or_ps(_mm_and_ps(on_normal, orig.getn()), _mm_andnot_ps(on_normal, clip_min));
+
+	PayloadId occluder[ao_occluder_capacity];
+	const size_t occluder_count = ts.gather(BBox(clip_min, clip_max, BBox::flag_direct()), occluder, ao_occluder_capacity);
+
+	float visibility = 1.f;
+
+	for (size_t i = 0; i < occluder_count; ++i)
+	{
+		const BBox& bbox = content[occluder[i]].get_bbox();
+		const __m128 min = _mm_sub_ps(_mm_max_ps(bbox.get_min(), clip_min), orig.getn());
+		const __m128 max = _mm_sub_ps(_mm_min_ps(bbox.get_max(), clip_max), orig.getn());
+
+		visibility *= 1.f - box_coverage(min, max, normal);
+	}
+
+	stats.ao_occluders += occluder_count;
+
+#elif AO_CONE != 0
+	float visibility = 0 != frame.cone_occupancy ?
+		cone_visibility(frame, orig, axis, axis_sign, stats) :
+		(lit[0] + lit[1] + lit[2] + lit[3]) / (all[0] + all[1] + all[2] + all[3]);
+
+#else
+	float visibility = (lit[0] + lit[1] + lit[2] + lit[3]) / (all[0] + all[1] + all[2] + all[3]);
+
+#endif
+#if AO_CACHE != 0
+	// take a converged texel's AO as is, otherwise fold this shading into the texel's running average
+	if (0 == probe_count)
+	{
+		visibility = cached_visibility;
+		stats.ao_cached += 1;
+	}
+	else
+	{
+		const uint32_t count = cached_count + 1;
+		visibility = cached_visibility + (visibility - cached_visibility) / count;
+
+		uint32_t bits;
+		memcpy(&bits, &visibility, sizeof(bits));
+
+		const uint64_t data = uint64_t(count) << 32 | bits;
+		__atomic_store_n(&cache_entry.data, data, __ATOMIC_RELAXED);
+		__atomic_store_n(&cache_entry.check, cache_key ^ data, __ATOMIC_RELAXED);
+	}
+
+#endif
+#if AO_TEMPORAL != 0
+	// reproject the hit into the previous frame, and accumulate onto the history there if that is of the same face of
+	// the same item; blend at the running-average rate up to the history cap, at a fixed rate past it
+	const simd::vect3 d = simd::vect3().sub(orig, simd::vect3().setn(0, frame.reproject[3]));
+	const float prev_right = d.dot(simd::vect3().setn(0, frame.reproject[0]));
+	const float prev_up = d.dot(simd::vect3().setn(0, frame.reproject[1]));
+	const float prev_forward = d.dot(simd::vect3().setn(0, frame.reproject[2]));
+
+	const float prev_x = (prev_right / prev_forward + 1.f) * (frame.w * .5f) + .5f;
+	const float prev_y = (prev_up / prev_forward + 1.f) * (frame.h * .5f) + .5f;
+
+	render::History& history = frame.history[y * frame.w + x];
+	history.target = hit.target;
+	history.face = face;
+	history.count = 1;
+
+	if (0.f < prev_forward &&
+		0.f <= prev_x && prev_x < frame.w &&
+		0.f <= prev_y && prev_y < frame.h)
+	{
+		const render::History& prev = frame.history_prev[unsigned(prev_y) * frame.w + unsigned(prev_x)];
+
+		if (prev.target == hit.target && prev.face == face)
+		{
+			history.count = prev.count < ao_history_cap ? prev.count + 1 : ao_history_cap;
+			visibility = prev.visibility + (visibility - prev.visibility) / history.count;
+		}
+	}
+
+	history.visibility = visibility;
+	stats.ao_history += history.count - 1;
+
+#endif
+	const float intensity = sqrtf(visibility);
+
+	render::set_intensity(pixel, uint8_t(255.f * intensity));
+
+#endif
+
+	// truncate payload id to 6 LSBs when storing it in the pixel
+	pixel[render::pixel_key] = size_t(hit.target) << 2 | (axis & 3) + 1;
+	aux.target = hit.target;
+
+#if AO_QUAD != 0
+	// this pixel's quarter of the quad's probes, for the quad gather
+	frame.quad[y * frame.w + x].lit = lit[0] + lit[1] + lit[2] + lit[3];
+	frame.quad[y * frame.w + x].all = all[0] + all[1] + all[2] + all[3];
+
+#endif
+#if DENOISE != 0
+	// input and guides of the denoiser
+	const size_t guide = y * frame.denoise_pitch + x;
+	frame.denoise_visibility[guide] = visibility;
+	frame.denoise_depth[guide] = hit.dist;
+	frame.denoise_key[guide] = pixel[render::pixel_key];
+
+#endif
+	stats.rays += probe_count;
+	stats.ao_pixels += 1;
+	stats.ao_probes += probe_count;
+
+#if AO_LOD != 0
+	stats.ao_nodes += Timeslice::flush_node_count();
+
+#endif
+}
+
+#else
+// shade pixel (x, y) of the frame by batches of 4 AO probes, each off the primary hit of its own subpixel position; the
+// AO of the hits is pooled over the pixel and scaled by the fraction of its positions hitting anything
+void
+shade_jittered(
+	const render::Frame& frame,
+	const unsigned x,
+	const unsigned y,
+	prng::State& rng,
+	render::Pixel& pixel,
+	render::Aux& aux,
+	render::Stats& stats)
+{
+	const Timeslice& ts = *reinterpret_cast< const Timeslice* >(frame.tree);
+	const unsigned w = frame.w;
+	const unsigned h = frame.h;
+
+	simd::vect3 cam_x, cam_y, cam_z, cam_o;
+	cam_x.setn(0, frame.cam[0]);
+	cam_y.setn(0, frame.cam[1]);
+	cam_z.setn(0, frame.cam[2]);
+	cam_o.setn(0, frame.cam[3]);
+
+	// subpixel positions follow the R2 sequence, rotated by the blue-noise mask a quarter of a tile off that rotating
+	// the AO sample sequence, so that positions and probe directions decorrelate
+	uint32_t jitter_rotation[2];
+	sampling::rotation(*frame.ao_rotation, x + sampling::blue_noise_size / 4, y, jitter_rotation);
+
+	__m128i rotation0 = _mm_setzero_si128();
+	__m128i rotation1 = _mm_setzero_si128();
+
+	if (0 != frame.ao_sequence)
+	{
+		uint32_t r[2];
+		sampling::rotation(*frame.ao_rotation, x, y, r);
+		rotation0 = _mm_set1_epi32(r[0] + frame.ao_shift[0]);
+		rotation1 = _mm_set1_epi32(r[1] + frame.ao_shift[1]);
+	}
+
+#if AO_LOD != 0
+	ts.set_lod_distance(frame.ao_lod);
+
+#endif
+	__m128 lit = _mm_set1_ps(0.f);
+	__m128 all = _mm_set1_ps(0.f);
+
+	size_t hit_count = 0;
+	PayloadId target = PayloadId(-1);
+	size_t target_axis = 0;
+
+	for (size_t i = 0; i < ao_probe_budget / 4; ++i)
+	{
+		uint32_t u[2];
+		sampling::r2(uint32_t(i), u);
+
+		const float jitter_x = (u[0] + jitter_rotation[0]) * (1.f / 4294967296.f) - .5f;
+		const float jitter_y = (u[1] + jitter_rotation[1]) * (1.f / 4294967296.f) - .5f;
+
+		const simd::vect3 offs = simd::vect3().add(
+			simd::vect3().mul(cam_y, ((y + jitter_y) * 2 - h) * (1.f / h)),
+			simd::vect3().mul(cam_x, ((x + jitter_x) * 2 - w) * (1.f / w)));
+
+		const Ray ray(cam_o, simd::vect3().add(cam_z, offs));
+
+		HitInfo hit;
+		hit.target = PayloadId(-1);
+
+		stats.rays += 1;
+
+#if HIT_PREDICTION != 0
+		// seed the traversal with the hit at the pixel last frame, as in shade
+		const Voxel* const predicted = ts.get_payload(aux.target);
+		const bool seeded = 0 != predicted &&
+			predicted->get_bbox().intersect(ray, hit.min_mask, hit.a_mask, hit.b_mask, hit.dist);
+
+		if (seeded)
+		{
+			hit.target = aux.target;
+
+			stats.predicted += 1;
+			stats.predicted_held += ts.traverse_seeded(ray, hit) ? 0 : 1;
+		}
+
+		if (!seeded && !traverse_primary(frame, x, y, ray, hit))
+			continue;
+
+#else
+		if (!traverse_primary(frame, x, y, ray, hit))
+			continue;
+
+#endif
+		size_t axis;
+		__m128 axis_sign;
+		simd::vect3 orig;
+		decode_hit(ray, hit, axis, axis_sign, orig);
+
+		// the pixel is keyed by its first hit
+		if (0 == hit_count)
+		{
+			target = hit.target;
+			target_axis = axis;
+		}
+
+		hit_count += 1;
+
+		__m128i ri0;
+		__m128i ri1;
+
+		if (0 != frame.ao_sequence)
+		{
+			const __m128i* const seq = reinterpret_cast< const __m128i* >(frame.ao_sequence) + i * 2;
+			ri0 = _mm_add_epi32(_mm_load_si128(seq + 0), rotation0);
+			ri1 = _mm_add_epi32(_mm_load_si128(seq + 1), rotation1);
+		}
+		else
+			prng::next(rng, ri0, ri1);
+
+		trace_hemisphere_probes(ts, orig, axis, axis_sign, ri0, ri1, hit, lit, all);
+
+		stats.rays += 4;
+		stats.ao_probes += 4;
+	}
+
+	if (0 == hit_count)
+	{
+		render::set_intensity(pixel, 0);
+		pixel[render::pixel_key] = 0;
+		aux.target = uint16_t(-1);
+		return;
+	}
+
+	const float visibility = (lit[0] + lit[1] + lit[2] + lit[3]) / (all[0] + all[1] + all[2] + all[3]);
+	const float intensity = sqrtf(visibility) * hit_count / (ao_probe_budget / 4);
+
+	render::set_intensity(pixel, uint8_t(255.f * intensity));
+
+	// truncate payload id to 6 LSBs when storing it in the pixel
+	pixel[render::pixel_key] = size_t(target) << 2 | (target_axis & 3) + 1;
+	aux.target = target;
+
+	stats.ao_pixels += 1;
+
+#if AO_LOD != 0
+	stats.ao_nodes += Timeslice::flush_node_count();
+
+#endif
+}
+
+#endif
+
+void
+raster_setup(
+	const render::Frame& frame,
+	const size_t begin,
+	const size_t end,
+	render::RasterFace* const face)
+{
+	const Voxel* const content = reinterpret_cast< const Voxel* >(frame.content);
+	const unsigned w = frame.w;
+	const unsigned h = frame.h;
+
+	simd::vect3 cam_x, cam_y, cam_z, cam_o;
+	cam_x.setn(0, frame.cam[0]);
+	cam_y.setn(0, frame.cam[1]);
+	cam_z.setn(0, frame.cam[2]);
+	cam_o.setn(0, frame.cam[3]);
+
+	// primary ray direction as a linear function of the pixel coordinates, as in shade: dir[0] + x * dir[1] + y * dir[2]
+	const simd::vect3 dir[3] = {
+		simd::vect3().sub(cam_z, simd::vect3().add(cam_x, cam_y)),
+		simd::vect3().mul(cam_x, 2.f / w),
+		simd::vect3().mul(cam_y, 2.f / h)
+	};
+
+	// an offset from the camera position decomposes as a * right + b * up + c * forward, where c is the distance along
+	// primary rays, and (a / c, b / c) is the position in the image plane, spanning [-1, 1] across the frame
+	const simd::vect3 proj_a = simd::vect3().cross(cam_y, cam_z);
+	const simd::vect3 proj_b = simd::vect3().cross(cam_z, cam_x);
+	const simd::vect3 proj_c = simd::vect3().cross(cam_x, cam_y);
+	const float rcp_det = 1.f / cam_x.dot(proj_a);
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const simd::vect3 min = content[i].get_min();
+		const simd::vect3 max = content[i].get_max();
+
+		for (size_t k = 0; k < render::raster_faces_per_item; ++k)
+		{
+			render::RasterFace& f = face[i * render::raster_faces_per_item + k];
+
+			f.id = int32_t(i);
+			f.x0 = 0;
+			f.y0 = 0;
+			f.x1 = 0;
+			f.y1 = 0;
+
+			// of the two faces along axis k, only the one on the camera side can be hit, if the camera is off the slab
+			const bool below = cam_o[k] < min[k];
+			const bool above = cam_o[k] > max[k];
+
+			if (!below && !above)
+				continue;
+
+			const float plane = below ? min[k] : max[k];
+			const float rcp_plane_dist = 1.f / (plane - cam_o[k]);
+
+			// inverse hit distance on the face plane: dir[k] / (plane - origin[k])
+			for (size_t c = 0; c < 3; ++c)
+				f.fn[4][c] = dir[c][k] * rcp_plane_dist;
+
+			// hit point within the face along the other two axes, as edge functions scaled by the inverse hit distance:
+			// (min[j] - origin[j]) * inv_dist <= dir[j] <= (max[j] - origin[j]) * inv_dist
+			const size_t axis[2] = { (k + 1) % 3, (k + 2) % 3 };
+
+			for (size_t e = 0; e < 2; ++e)
+			{
+				const size_t j = axis[e];
+				const float lo = min[j] - cam_o[j];
+				const float hi = max[j] - cam_o[j];
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					f.fn[e * 2 + 0][c] = dir[c][j] - lo * f.fn[4][c];
+					f.fn[e * 2 + 1][c] = hi * f.fn[4][c] - dir[c][j];
+				}
+			}
+
+			// bound the face on screen by its projected corners; a face straddling the plane of the camera cannot be
+			// bounded that way, but then its edge functions hold regardless, so let it span the frame
+			float rect_min[2] = { float(w), float(h) };
+			float rect_max[2] = { -1.f, -1.f };
+			size_t behind = 0;
+
+			for (size_t corner = 0; corner < 4; ++corner)
+			{
+				simd::vect3 q;
+				q.set(k, plane);
+				q.set(axis[0], corner & 1 ? max[axis[0]] : min[axis[0]]);
+				q.set(axis[1], corner & 2 ? max[axis[1]] : min[axis[1]]);
+
+				const simd::vect3 p = simd::vect3().sub(q, cam_o);
+
+				const float c = p.dot(proj_c) * rcp_det;
+
+				if (c <= 0.f)
+				{
+					++behind;
+					continue;
+				}
+
+				const float rcp_c = rcp_det / c;
+				const float px = (p.dot(proj_a) * rcp_c + 1.f) * (w * .5f);
+				const float py = (p.dot(proj_b) * rcp_c + 1.f) * (h * .5f);
+
+				rect_min[0] = std::min(rect_min[0], px);
+				rect_min[1] = std::min(rect_min[1], py);
+				rect_max[0] = std::max(rect_max[0], px);
+				rect_max[1] = std::max(rect_max[1], py);
+			}
+
+			if (4 == behind)
+				continue;
+
+			if (0 != behind)
+			{
+				f.x1 = uint16_t(w);
+				f.y1 = uint16_t(h);
+				continue;
+			}
+
+			// pixel (x, y) samples the image plane at exactly (x, y); widen the bounds by a pixel for rounding, and clamp
+			// them to the frame, as boxes off screen project outside it either way
+			f.x0 = uint16_t(std::min(std::max(rect_min[0] - 1.f, 0.f), float(w)));
+			f.y0 = uint16_t(std::min(std::max(rect_min[1] - 1.f, 0.f), float(h)));
+			f.x1 = uint16_t(std::min(std::max(rect_max[0] + 2.f, 0.f), float(w)));
+			f.y1 = uint16_t(std::min(std::max(rect_max[1] + 2.f, 0.f), float(h)));
+		}
+	}
+}
+
+
+void
+raster(
+	const render::Frame& frame,
+	const render::RasterFace* const face,
+	const size_t face_count,
+	const unsigned x0,
+	const unsigned y0,
+	const unsigned x1,
+	const unsigned y1)
+{
+	assert(0 == x0 % 4);
+	assert(0 == x1 % 4 || frame.w == x1);
+
+	const unsigned pitch = frame.raster_pitch;
+	const unsigned span_end = x1 + 3 & ~3U; // past the frame width this stays within the row padding
+	float* const depth = frame.raster_depth;
+	int32_t* const id = frame.raster_id;
+
+	for (unsigned y = y0; y < y1; ++y)
+		for (unsigned x = x0; x < span_end; x += 4)
+		{
+			_mm_storeu_ps(depth + y * pitch + x, _mm_setzero_ps());
+			_mm_storeu_si128(reinterpret_cast< __m128i* >(id + y * pitch + x), _mm_set1_epi32(-1));
+		}
+
+	const __m128 lane = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+
+	for (size_t i = 0; i < face_count; ++i)
+	{
+		const render::RasterFace& f = face[i];
+		const unsigned fx0 = std::max(unsigned(f.x0), x0) & ~3U;
+		const unsigned fy0 = std::max(unsigned(f.y0), y0);
+		const unsigned fx1 = std::min(unsigned(f.x1), x1);
+		const unsigned fy1 = std::min(unsigned(f.y1), y1);
+
+		if (fx0 >= fx1 || fy0 >= fy1)
+			continue;
+
+		const __m128i face_id = _mm_set1_epi32(f.id);
+
+		for (unsigned y = fy0; y < fy1; ++y)
+		{
+			__m128 row[5];
+			__m128 col[5];
+
+			for (size_t e = 0; e < 5; ++e)
+			{
+				row[e] = _mm_set1_ps(f.fn[e][0] + f.fn[e][2] * y);
+				col[e] = _mm_set1_ps(f.fn[e][1]);
+			}
+
+			for (unsigned x = fx0; x < fx1; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), lane);
+
+				const __m128 e0 = _mm_add_ps(row[0], _mm_mul_ps(px, col[0]));
+				const __m128 e1 = _mm_add_ps(row[1], _mm_mul_ps(px, col[1]));
+				const __m128 e2 = _mm_add_ps(row[2], _mm_mul_ps(px, col[2]));
+				const __m128 e3 = _mm_add_ps(row[3], _mm_mul_ps(px, col[3]));
+				const __m128 inv_dist = _mm_add_ps(row[4], _mm_mul_ps(px, col[4]));
+
+				float* const depth_at = depth + y * pitch + x;
+				int32_t* const id_at = id + y * pitch + x;
+				const __m128 prior = _mm_loadu_ps(depth_at);
+
+				// inside all edges and nearer than anything so far; the latter also rejects hits behind the camera
+				const __m128 nearer = _mm_and_ps(
+					_mm_and_ps(
+						_mm_cmpge_ps(e0, _mm_setzero_ps()),
+						_mm_cmpge_ps(e1, _mm_setzero_ps())),
+					_mm_and_ps(
+						_mm_and_ps(
+							_mm_cmpge_ps(e2, _mm_setzero_ps()),
+							_mm_cmpge_ps(e3, _mm_setzero_ps())),
+						_mm_cmpgt_ps(inv_dist, prior)));
+
+				if (0 == _mm_movemask_ps(nearer))
+					continue;
+
+				const __m128i mask = _mm_castps_si128(nearer);
+				const __m128i prior_id = _mm_loadu_si128(reinterpret_cast< const __m128i* >(id_at));
+
+				_mm_storeu_ps(depth_at, _mm_or_ps(_mm_and_ps(nearer, inv_dist), _mm_andnot_ps(nearer, prior)));
+				_mm_storeu_si128(reinterpret_cast< __m128i* >(id_at),
+					_mm_or_si128(_mm_and_si128(mask, face_id), _mm_andnot_si128(mask, prior_id)));
+			}
+		}
+	}
+}
+
+
+void
+beam(
+	const render::Frame& frame,
+	const unsigned x0,
+	const unsigned y0,
+	const unsigned x1,
+	const unsigned y1,
+	::BeamEntry& entry_opaque,
+	render::Stats& stats)
+{
+#if BEAM_PREPASS != 0
+	const Timeslice& ts = *reinterpret_cast< const Timeslice* >(frame.tree);
+	BeamEntry& entry = reinterpret_cast< BeamEntry& >(entry_opaque);
+	const unsigned w = frame.w;
+	const unsigned h = frame.h;
+
+	simd::vect3 cam_x, cam_y, cam_z, cam_o;
+	cam_x.setn(0, frame.cam[0]);
+	cam_y.setn(0, frame.cam[1]);
+	cam_z.setn(0, frame.cam[2]);
+	cam_o.setn(0, frame.cam[3]);
+
+	// primary ray directions at the tile corners, as in shade; pad the tile by half a pixel to keep the rays of the
+	// edge pixels inside the cone regardless of rounding, or by a whole pixel when those rays are jittered
+#if PRIMARY_JITTER != 0
+	const float pad = 1.f;
+
+#else
+	const float pad = .5f;
+
+#endif
+	const float ex[2] = { x0 - pad, x1 - 1.f + pad };
+	const float ey[2] = { y0 - pad, y1 - 1.f + pad };
+	const unsigned cyclic[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+	simd::vect3 edge[4];
+
+	for (size_t i = 0; i < 4; ++i)
+		edge[i] = simd::vect3().add(cam_z, simd::vect3().add(
+			simd::vect3().mul(cam_y, (ey[cyclic[i][1]] * 2 - h) * (1.f / h)),
+			simd::vect3().mul(cam_x, (ex[cyclic[i][0]] * 2 - w) * (1.f / w))));
+
+	ts.find_beam_entry(cam_o, edge, entry);
+
+	stats.beam_tiles += 1;
+	stats.beam_misses += octree_level_count == entry.level ? 1 : 0;
+	stats.beam_levels += octree_level_count == entry.level ? 0 : entry.level;
+
+#endif
+}
+
+
+void
+denoise(
+	const render::Frame& frame,
+	const float* const src,
+	float* const dst,
+	const unsigned step,
+	const unsigned y0,
+	const unsigned y1,
+	render::Pixel* const framebuffer)
+{
+#if DENOISE != 0
+	// B3-spline taps of the a-trous wavelet transform
+	const float tap[5] = { 1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4, 1.f / 16 };
+
+	const unsigned w = frame.w;
+	const unsigned h = frame.h;
+	const ptrdiff_t pitch = frame.denoise_pitch;
+	const __m128i axis_mask = _mm_set1_epi32(3);
+
+	// pixels of 4-pixel groups: the frame width is padded to a multiple of 4, and taps past the frame edges fall onto the
+	// row padding, keyed as misses
+	for (unsigned y = y0; y < y1; ++y)
+		for (unsigned x = 0; x < w; x += 4)
+		{
+			const ptrdiff_t p = y * pitch + x;
+			const __m128i key_p = _mm_loadu_si128(reinterpret_cast< const __m128i* >(frame.denoise_key + p));
+			const __m128i axis_p = _mm_and_si128(key_p, axis_mask);
+			const __m128 depth_p = _mm_loadu_ps(frame.denoise_depth + p);
+
+			// taps off the item face at p must be close in distance relative to p's, taps off other items -- closer
+			const __m128 rcp_same = _mm_div_ps(_mm_set1_ps(1.f),
+				_mm_mul_ps(depth_p, _mm_set1_ps(denoise_depth_same * step)));
+			const __m128 rcp_other = _mm_div_ps(_mm_set1_ps(1.f),
+				_mm_mul_ps(depth_p, _mm_set1_ps(denoise_depth_other * step)));
+
+			__m128 sum = _mm_setzero_ps();
+			__m128 weight = _mm_setzero_ps();
+
+			for (int j = -2; j <= 2; ++j)
+			{
+				const int yq = int(y) + j * int(step);
+
+				if (0 > yq || int(h) <= yq)
+					continue;
+
+				for (int i = -2; i <= 2; ++i)
+				{
+					const ptrdiff_t q = yq * pitch + int(x) + i * int(step);
+					const __m128i key_q = _mm_loadu_si128(reinterpret_cast< const __m128i* >(frame.denoise_key + q));
+					const __m128 depth_q = _mm_loadu_ps(frame.denoise_depth + q);
+					const __m128 visibility_q = _mm_loadu_ps(src + q);
+
+					// only hits on faces of the same axis count; misses have no axis
+					const __m128 valid = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(key_q, axis_mask), axis_p));
+					const __m128 same = _mm_castsi128_ps(_mm_cmpeq_epi32(key_q, key_p));
+					const __m128 rcp_sigma = _mm_or_ps(_mm_and_ps(same, rcp_same), _mm_andnot_ps(same, rcp_other));
+					const __m128 dist = _mm_mul_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), _mm_sub_ps(depth_q, depth_p)), rcp_sigma);
+					const __m128 w_q = _mm_mul_ps(_mm_set1_ps(tap[i + 2] * tap[j + 2]),
+						exp_ps(_mm_xor_ps(dist, _mm_set1_ps(-0.f))));
+
+					// mask after the products, as planes hold anything at misses
+					sum = _mm_add_ps(sum, _mm_and_ps(valid, _mm_mul_ps(w_q, visibility_q)));
+					weight = _mm_add_ps(weight, _mm_and_ps(valid, w_q));
+				}
+			}
+
+			const __m128 result = _mm_div_ps(sum, _mm_max_ps(weight, _mm_set1_ps(1e-20f)));
+
+			if (0 != dst)
+			{
+				_mm_storeu_ps(dst + p, result);
+				continue;
+			}
+
+			const __m128 intensity = _mm_mul_ps(_mm_sqrt_ps(result), _mm_set1_ps(255.f));
+
+			for (unsigned k = 0; k < 4 && x + k < w; ++k)
+			{
+				if (0 == frame.denoise_key[p + k])
+					continue;
+
+				render::set_intensity(framebuffer[y * w + x + k], uint8_t(intensity[k]));
+			}
+		}
+
+#endif
+}
+
+// collect the counts kept by this thread's traversals since the last call
+static void
+flush_stats(
+	render::Stats& stats)
+{
+#if TRAVERSE_PREFETCH != 0
+	stats.prefetches += Timeslice::flush_prefetch_count();
+
+#endif
+}
+
+} // namespace
+
+#define RENDER_STRINGIFY_(x) #x
+#define RENDER_STRINGIFY(x) RENDER_STRINGIFY_(x)
+#define RENDER_KERNEL_(isa) RENDER_KERNEL(isa)
+
+extern const render::Kernel RENDER_KERNEL_(RENDER_ISA) = {
+	RENDER_STRINGIFY(RENDER_ISA),
+#if PRIMARY_JITTER != 0
+	shade_jittered,
+#else
+	shade,
+#endif
+	raster_setup,
+	raster,
+	beam,
+	denoise,
+	flush_stats
+};
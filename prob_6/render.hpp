@@ -0,0 +1,271 @@
+#ifndef render_H__
+#define render_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <xmmintrin.h>
+#include "prng_simd.hpp"
+#include "sample_seq.hpp"
+
+class Timeslice;
+class Voxel;
+struct BeamEntry;
+
+namespace render {
+
+// Render kernel -- the per-pixel half of the renderer: primary ray, AO probes and pixel packing. The kernel translation
+// unit is built once per ISA level; main picks the preferred level supported by the host at startup.
+
+// tabulated AO probe direction, with its reciprocal precomputed; tables come in face orientations x+, x-, y+, y-, z+, z-,
+// each holding the same cosine-weighted hemisphere about the face normal
+struct ProbeDir
+{
+	__m128 dir;
+	__m128 rcpdir;
+};
+
+enum
+{
+	probe_dir_log2 = 10,
+	probe_dir_count = 1 << probe_dir_log2, // directions per face orientation
+	probe_face_count = 6
+};
+
+// per-pixel AO history for temporal accumulation
+struct History
+{
+	float visibility; // accumulated AO visibility estimate
+	uint16_t target;  // full payload id of the primary hit, or uint16_t(-1) for none
+	uint8_t face;     // face orientation of the primary hit: x+, x-, y+, y-, z+, z-
+	uint8_t count;    // frames accumulated, saturating at the history cap
+};
+
+// probe sums of a pixel's quarter of the AO probes of its 2x2 pixel quad
+struct QuadAo
+{
+	float lit; // cosine-weighted sum of the unoccluded probes
+	float all; // cosine-weighted sum of all probes
+};
+
+// AO cache entry: the AO accumulated over a texel of an item face; the check word is the key xor the data word, so that
+// an entry torn by concurrent writers fails the key check rather than yield another texel's data
+struct AoCacheEntry
+{
+	uint64_t check;
+	uint64_t data; // visibility as float bits in the low half, count of shadings accumulated in the high half
+};
+
+enum
+{
+	ao_cache_log2 = 20,      // entries in the AO cache
+	ao_cache_texel_log2 = 4, // AO cache texels per unit of length along item faces
+	ao_cache_converged = 8   // shadings accumulated, past which a texel takes its AO from the cache alone
+};
+
+// per-frame input to the kernel
+struct Frame
+{
+	const Timeslice* tree;
+	const Voxel* content;  // payload the tree was built from; payload ids are indices in it
+	size_t content_count;
+
+	__m128 cam[4];         // right, up, forward and position vectors
+	unsigned w;
+	unsigned h;
+
+	float* raster_depth;   // primary visibility as inverse hit distance per pixel, zero for none
+	int32_t* raster_id;    // primary visibility as payload id per pixel, -1 for none; null when not rasterized
+	unsigned raster_pitch; // row pitch of the primary-visibility buffers, a multiple of 4 pixels
+
+	const BeamEntry* beam; // tree entry points per beam tile, row by row; null when not available
+	unsigned beam_tiles_x; // beam tiles per row
+
+	float ao_lod;          // distance past which AO probes take occupied leaf nodes for occluders; zero for exact AO
+	float ao_tolerance;    // standard error of the AO visibility estimate at which a pixel stops tracing probes
+	float ao_radius;       // reach of the analytic AO occluders about the hit; zero when not computing AO analytically
+
+	const uint32_t* ao_sequence; // AO sample sequence, per batch of 4 probes the 4 decl samples followed by the 4 azim
+	                             // ones; null for random sampling
+	const uint32_t (* ao_rotation)[sampling::blue_noise_cells]; // per-pixel rotations of the AO sample sequence
+
+	const ProbeDir (* probe_dir)[probe_dir_count]; // AO probe directions per face orientation; null when not tabulated
+	const float* probe_cos;                        // cosines of the tabulated AO probe directions to the face normal
+
+	uint32_t ao_shift[2];        // rotation of the AO sample sequence common to all pixels, added to their own
+
+	const History* history_prev; // AO history of the previous frame, per pixel; null when not accumulating
+	History* history;            // AO history of this frame, per pixel
+	__m128 reproject[4];         // previous camera: rows of the inverse of its right, up, forward basis, and its position
+
+	AoCacheEntry* ao_cache;      // AO cache of 1 << ao_cache_log2 entries; null when not caching
+	const uint32_t* ao_cache_tag; // per payload id, a tag changing whenever the item or its vicinity changes
+
+	float* denoise_visibility;   // AO visibility per pixel, input to the denoiser; null when not denoising
+	float* denoise_depth;        // hit distance per pixel
+	int32_t* denoise_key;        // pixel key per pixel -- truncated payload id and hit axis, zero for none
+	unsigned denoise_pitch;      // row pitch of the denoiser planes; rows are padded by denoise_pad on either side
+
+	QuadAo* quad;                // per pixel, probe sums of its quarter of its quad's probes; null when not gathering quads
+
+	const float* cone_occupancy; // occupancy pyramid for cone-traced AO; null for probe-traced AO
+	__m128 cone_origin;          // min corner of the cube the pyramid spans
+	float cone_scale;            // cells of the finest pyramid level per unit of length
+};
+
+// occupancy pyramid for cone-traced AO: levels of a cube of cells holding the fraction of their volume taken by items,
+// from (1 << cone_grid_log2)^3 cells down to a single one, back to back; cells run x fastest, then y, then z
+enum
+{
+	cone_grid_log2 = 7,
+	cone_grid_size = 1 << cone_grid_log2,
+	cone_level_count = cone_grid_log2 + 1,
+	cone_pyramid_count = (cone_grid_size * cone_grid_size * cone_grid_size - 1) / 7 * 8 + 1 // cells of all levels
+};
+
+enum
+{
+	denoise_passes_max = 5, // passes of the denoiser, taps of pass i being 1 << i pixels apart
+	denoise_pad = 36        // row padding of the denoiser planes, fitting the farthest taps of 4-pixel groups
+};
+
+enum { beam_tile_size = 8 }; // side of the square pixel tiles sharing a tree entry point
+
+// framebuffer pixel: AO intensity in each of its leading channels, followed by the pixel key -- truncated payload id and
+// hit axis, zero for a miss; RGBA8 pixels repeat the intensity in R, G and B, compact pixels hold it once
+#if COMPACT_PIXEL != 0
+enum { pixel_key = 1 };
+
+#else
+enum { pixel_key = 3 };
+
+#endif
+typedef uint8_t Pixel[pixel_key + 1];
+
+// set the AO intensity of a pixel
+static inline void
+set_intensity(
+	Pixel& pixel,
+	const uint8_t intensity)
+{
+	for (size_t i = 0; i < pixel_key; ++i)
+		pixel[i] = intensity;
+}
+
+// per-pixel data kept alongside the framebuffer, persisting across frames
+struct Aux
+{
+	uint16_t target; // full payload id of the primary hit, or uint16_t(-1) for a miss
+};
+
+// per-worker statistics, accumulated by the kernel
+struct Stats
+{
+	uint64_t rays;           // rays traced
+	uint64_t predicted;      // primary rays seeded with a predicted hit
+	uint64_t predicted_held; // predicted hits that turned out nearest
+	uint64_t prefetches;     // prefetches issued by traversals
+	uint64_t beam_tiles;     // beam tiles processed
+	uint64_t beam_misses;    // beam tiles found to miss the tree altogether
+	uint64_t beam_levels;    // tree levels skipped by the beam entries of the remaining tiles
+	uint64_t ao_pixels;      // pixels shaded with AO
+	uint64_t ao_probes;      // AO probes traced
+	uint64_t ao_history;     // frames of AO history reused
+	uint64_t ao_cached;      // AO pixels taken from the AO cache
+	uint64_t ao_occluders;   // boxes taken for analytic AO occluders
+	uint64_t ao_cone_steps;  // steps of AO cone marches
+	uint64_t ao_nodes;       // tree nodes visited by AO probes
+};
+
+// payload item face prepared for rasterization: linear functions of the pixel coordinates, given as coefficients of
+// 1, x and y -- four edge functions, non-negative inside the face, followed by the inverse hit distance
+struct RasterFace
+{
+	float fn[5][3];
+	int32_t id;
+	uint16_t x0, y0, x1, y1; // pixel rectangle covering the face, exclusive at the far ends; empty for unused faces
+};
+
+enum { raster_faces_per_item = 3 }; // at most three faces of an axis-aligned box face any given point outside of it
+
+struct Kernel
+{
+	const char* name;
+
+	// shade pixel (x, y) of the frame; use the rasterized primary visibility if available
+	void (* shade)(
+		const Frame& frame,
+		const unsigned x,
+		const unsigned y,
+		prng::State& rng,
+		Pixel& pixel,
+		Aux& aux,
+		Stats& stats);
+
+	// prepare for rasterization the faces of content items [begin, end) which face the camera; each item has its own
+	// raster_faces_per_item consecutive slots in the face array, with slots of faces not facing the camera left empty
+	void (* raster_setup)(
+		const Frame& frame,
+		const size_t begin,
+		const size_t end,
+		RasterFace* const face);
+
+	// rasterize the given faces into the primary-visibility buffers of the frame, within pixel rectangle [x0, x1) * [y0, y1);
+	// x0 must be a multiple of 4, and so must x1 unless it is the frame width -- pixels are processed in groups of 4
+	void (* raster)(
+		const Frame& frame,
+		const RasterFace* const face,
+		const size_t face_count,
+		const unsigned x0,
+		const unsigned y0,
+		const unsigned x1,
+		const unsigned y1);
+
+	// find the tree entry point for the primary rays of pixel rectangle [x0, x1) * [y0, y1)
+	void (* beam)(
+		const Frame& frame,
+		const unsigned x0,
+		const unsigned y0,
+		const unsigned x1,
+		const unsigned y1,
+		BeamEntry& entry,
+		Stats& stats);
+
+	// run a pass of the edge-aware AO denoiser over rows [y0, y1) of the frame: filter the given visibility plane with
+	// 5x5 a-trous taps of the given step, weighted by hit axis, payload id and hit distance; write the result to dst, or,
+	// if that is null, as AO to the framebuffer
+	void (* denoise)(
+		const Frame& frame,
+		const float* const src,
+		float* const dst,
+		const unsigned step,
+		const unsigned y0,
+		const unsigned y1,
+		Pixel* const framebuffer);
+
+	// collect into the given statistics the counts kept by the calling thread's traversals since the last call; due
+	// once a worker is done shading
+	void (* flush_stats)(
+		Stats& stats);
+};
+
+} // namespace render
+
+#define RENDER_KERNEL(isa) render_kernel_ ## isa
+
+#if RENDER_ISA_SSE2 != 0
+extern const render::Kernel RENDER_KERNEL(sse2);
+#endif
+#if RENDER_ISA_SSE4_1 != 0
+extern const render::Kernel RENDER_KERNEL(sse4_1);
+#endif
+#if RENDER_ISA_AVX != 0
+extern const render::Kernel RENDER_KERNEL(avx);
+#endif
+#if RENDER_ISA_AVX2 != 0
+extern const render::Kernel RENDER_KERNEL(avx2);
+#endif
+#if RENDER_ISA_AVX512 != 0
+extern const render::Kernel RENDER_KERNEL(avx512);
+#endif
+
+#endif // render_H__
@@ -32,6 +32,8 @@ CFLAGS=(
 	-DMINIMAL_TREE=1
 # Draw octree cells instead of octree content
 #	-DDRAW_TREE_CELLS=1
+# AO sample sequence, rotated per pixel by a blue-noise mask: 1 - R2, 2 - Sobol; default is independent randoms
+#	-DAO_SAMPLING=1
 # Clang static code analysis:
 #	--analyze
 # Compiler quirk 0001: control definition location of routines posing entry points to recursion for more efficient inlining
@@ -28,6 +28,20 @@
 	uint result = traverse(get_octet(src_a, 0), src_b, src_c, &root_bbox, &ray.ray, &ray.hit);
 
 	if (-1U != result) {
+#if AO_SAMPLING != 0
+		// the frame picks the sample of the sequence, the pixel rotates it by its values of the blue-noise mask
+		const int noise_size = 1 << BLUE_NOISE_LOG2;
+#if OCL_QUIRK_0001
+		__constant uint* const rotation = (__constant uint*)(src_d + 24);
+#else
+		__constant uint* const rotation = (__constant uint*)(src_d + 6);
+#endif
+		const uint2 u = sample_seq(frame) + (uint2)(
+			rotation[(idy & noise_size - 1) * noise_size + (idx & noise_size - 1)],
+			rotation[(idy + noise_size / 2 & noise_size - 1) * noise_size + (idx + noise_size / 2 & noise_size - 1)]);
+		const unsigned ri0 = u.x >> 8;
+		const unsigned ri1 = u.y >> 8;
+#else
 		const unsigned seed = get_global_id(0) + get_global_id(1) * get_global_size(0) + frame * get_global_size(1) * get_global_size(0);
 #if 0
 		const unsigned ri0 = xorshift(seed) * 0x5557 >> 8;
@@ -35,6 +49,7 @@
 #else
 		const unsigned ri0 = xorshift(seed) * 0xa47f >> 8;
 		const unsigned ri1 = xorshift(seed) * 0xa175 >> 8;
+#endif
 #endif
 		const unsigned max_rand = (1U << 24) - 1;
 
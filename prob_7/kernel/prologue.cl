@@ -353,6 +353,26 @@ uint octet_intersect_wide(
 	return as_uint(count);
 }
 
+#if AO_SAMPLING != 0
+// sample n of the AO sample sequence, as 32-bit fractions; verbatim from common/sample_seq.hpp
+uint2 sample_seq(const uint n) {
+#if AO_SAMPLING == 1
+    return (uint2)(0x80000000U + n * 3242174889U, 0x80000000U + n * 2447445414U);
+#else
+    uint2 u = (uint2)(0);
+    uint v0 = 1U << 31;
+    uint v1 = 1U << 31;
+    for (uint i = n; 0 != i; i >>= 1) {
+        if (i & 1)
+            u ^= (uint2)(v0, v1);
+        v0 >>= 1;
+        v1 ^= v1 >> 1;
+    }
+    return u;
+#endif
+}
+
+#endif
 // see George Marsaglia http://www.jstatsoft.org/v08/i14/paper
 unsigned xorshift(unsigned value) {
     value ^= value << 13;
@@ -17,6 +17,7 @@
 #include "timer.h"
 #include "vectnative.hpp"
 #include "pure_macro.hpp"
+#include "sample_seq.hpp"
 #include "cl_util.hpp"
 #include "cl_wrap.hpp"
 #include "platform.hpp"
@@ -1785,8 +1786,14 @@ int main(int argc, char** argv) {
 	// CARB (camera and root bbox) constant buffer element:
 	// float4
 	const size_t carb_w = 1;
+#if AO_SAMPLING != 0
+	const size_t carb_h = 6 + sampling::blue_noise_cells / 4; // camera and root bbox, followed by AO sample rotations
+
+#else
 	const size_t carb_h = 6;
 
+#endif
+
 	const size_t mem_size_carb = carb_w * carb_h * sizeof(cl_float4);
 	const size_t carb_count = mem_size_carb / sizeof(cl_float4);
 
@@ -1803,6 +1810,15 @@ int main(int argc, char** argv) {
 	for (size_t i = 0; i < COUNT_OF(carb_map_buffer); ++i)
 		carb_map_buffer[i] = carb_map() + i * carb_count;
 
+#if AO_SAMPLING != 0
+	uint32_t ao_rotation[sampling::blue_noise_cells];
+	sampling::build_blue_noise(ao_rotation);
+
+	for (size_t i = 0; i < COUNT_OF(carb_map_buffer); ++i)
+		std::memcpy(carb_map_buffer[i] + 6, ao_rotation, sizeof(ao_rotation));
+
+#endif
+
 	// create cl mem objects ///////////////////////////////////////////////////
 	const cl_image_format src_image_format_ushort4 = {
 		CL_RGBA,				// cl_channel_order image_channel_order;
@@ -2085,6 +2101,9 @@ int main(int argc, char** argv) {
 #if OCL_QUIRK_0004
 		" -D OCL_QUIRK_0004"
 #endif
+#if AO_SAMPLING != 0
+		" -D AO_SAMPLING=" XQUOTE(AO_SAMPLING) " -D BLUE_NOISE_LOG2=" XQUOTE(SAMPLE_SEQ_BLUE_NOISE_LOG2)
+#endif
 ;
 	success = clBuildProgram(program, 1, device() + device_idx, build_opt, 0, 0);
 